@@ -154,6 +154,7 @@ const BasicBlock& Function::getBB(string_view name) const {
 
 void Function::removeBB(BasicBlock &BB) {
   assert(BB.getName() != "#sink");
+  unroll_iters.erase(&BB);
   BBs.erase(BB.getName());
 
   for (auto I = BB_order.begin(), E = BB_order.end(); I != E; ++I) {
@@ -544,6 +545,9 @@ void Function::unroll(unsigned k) {
         auto &copies = bbmap.at(bb);
         copies.emplace_back(&cloneBB(*this, *bb, suffix.c_str(), bbmap, vmap));
         unrolled_bbs.emplace_back(copies.back());
+        // the n-th copy of the header is reached after n-1 iterations
+        unroll_iters[copies.back()]
+          = max(getUnrollIteration(*bb), bb == header ? unroll-1 : unroll);
       }
     }
 
@@ -555,6 +559,7 @@ void Function::unroll(unsigned k) {
       auto &copies = bbmap.at(header);
       copies.emplace_back(&cloneBB(*this, *header, "#exit", bbmap, vmap));
       unrolled_bbs.emplace_back(copies.back());
+      unroll_iters[copies.back()] = max(getUnrollIteration(*header), k);
     }
 
     // Patch jump targets
@@ -741,6 +746,11 @@ void Function::unroll(unsigned k) {
   }
 }
 
+unsigned Function::getUnrollIteration(const BasicBlock &bb) const {
+  auto I = unroll_iters.find(&bb);
+  return I == unroll_iters.end() ? 0 : I->second;
+}
+
 void Function::print(ostream &os, bool print_header) const {
   {
     const auto &gvars = getGlobalVars();
@@ -64,6 +64,9 @@ class Function final {
 
   static BasicBlock sink_bb;
 
+  // BB copies made by unroll -> loop iteration they belong to
+  std::unordered_map<const BasicBlock*, unsigned> unroll_iters;
+
   unsigned bits_pointers = 64;
   unsigned bits_ptr_offset = 64;
   bool little_endian = true;
@@ -178,6 +181,8 @@ public:
 
   void topSort();
   void unroll(unsigned k);
+  // 0 if bb is not a copy made by unroll
+  unsigned getUnrollIteration(const BasicBlock &bb) const;
 
   void print(std::ostream &os, bool print_header = true) const;
   friend std::ostream &operator<<(std::ostream &os, const Function &f);
@@ -7,83 +7,86 @@ namespace smt { class expr; }
 
 namespace IR {
 
+// The encoding parameters are per thread so that independent transformations
+// can be verified concurrently.
+
 /// Upperbound of the number of local blocks
-extern unsigned num_locals_src, num_locals_tgt;
+extern thread_local unsigned num_locals_src, num_locals_tgt;
 
 /// Number of constant global variables in src
-extern unsigned num_consts_src;
+extern thread_local unsigned num_consts_src;
 
-extern unsigned num_globals_src;
+extern thread_local unsigned num_globals_src;
 
-extern unsigned num_ptrinputs;
+extern thread_local unsigned num_ptrinputs;
 
 /// Number of non-constant globals introduced in tgt
-extern unsigned num_extra_nonconst_tgt;
+extern thread_local unsigned num_extra_nonconst_tgt;
 
 // Upperbound of the number of nonlocal blocks
-extern unsigned num_nonlocals;
+extern thread_local unsigned num_nonlocals;
 
 // Upperbound of the number of nonlocal blocks in src (<= num_nonlocals)
-extern unsigned num_nonlocals_src;
+extern thread_local unsigned num_nonlocals_src;
 
-extern unsigned bits_poison_per_byte;
+extern thread_local unsigned bits_poison_per_byte;
 
 /// Number of bits needed for attributes of pointers (e.g. nocapture).
-extern unsigned bits_for_ptrattrs;
+extern thread_local unsigned bits_for_ptrattrs;
 
 /// Number of bits needed for encoding a memory block id
-extern unsigned bits_for_bid;
+extern thread_local unsigned bits_for_bid;
 
 // Number of bits needed for encoding a pointer's offset
-extern unsigned bits_for_offset;
+extern thread_local unsigned bits_for_offset;
 
 /// Size of a program pointer in bytes
-extern unsigned bits_program_pointer;
+extern thread_local unsigned bits_program_pointer;
 
 /// sizeof(size_t)
-extern unsigned bits_size_t;
+extern thread_local unsigned bits_size_t;
 
 /// >= bits_size_t && <= bits_program_pointer
-extern unsigned bits_ptr_address;
+extern thread_local unsigned bits_ptr_address;
 
 /// Number of bits for a byte.
-extern unsigned bits_byte;
+extern thread_local unsigned bits_byte;
 
-extern unsigned strlen_unroll_cnt;
-extern unsigned memcmp_unroll_cnt;
+extern thread_local unsigned strlen_unroll_cnt;
+extern thread_local unsigned memcmp_unroll_cnt;
 
-extern bool little_endian;
+extern thread_local bool little_endian;
 
 /// Whether int2ptr or ptr2int are used in either function
-extern bool has_int2ptr;
-extern bool has_ptr2int;
+extern thread_local bool has_int2ptr;
+extern thread_local bool has_ptr2int;
 
 /// Whether malloc or free/delete is used in either function
-extern bool has_malloc;
-extern bool has_free;
+extern thread_local bool has_malloc;
+extern thread_local bool has_free;
 /// Whether there is an alloca
-extern bool has_alloca;
+extern thread_local bool has_alloca;
 
-extern bool has_fncall;
+extern thread_local bool has_fncall;
 
 /// Whether any function argument (not function call arg) has the attribute
-extern bool has_nocapture;
-extern bool has_noread;
-extern bool has_nowrite;
+extern thread_local bool has_nocapture;
+extern thread_local bool has_noread;
+extern thread_local bool has_nowrite;
 
 /// Whether there are allocas that are initially dead (need start_lifetime)
-extern bool has_dead_allocas;
+extern thread_local bool has_dead_allocas;
 
 /// Whether there is a pointer that can point to the null block
 /// ex) undef ptr constant, fn arg
-extern bool has_null_block;
+extern thread_local bool has_null_block;
 
 /// Whether the programs do memory accesses that load/store int/ptrs
-extern bool does_int_mem_access;
-extern bool does_ptr_mem_access;
-extern bool does_ptr_store;
+extern thread_local bool does_int_mem_access;
+extern thread_local bool does_ptr_mem_access;
+extern thread_local bool does_ptr_store;
 
-extern unsigned heap_block_alignment;
+extern thread_local unsigned heap_block_alignment;
 
 
 bool isUndef(const smt::expr &e);
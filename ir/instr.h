@@ -48,6 +48,11 @@ public:
   BinOp(Type &type, std::string &&name, Value &lhs, Value &rhs, Op op,
         unsigned flags = 0, FastMathFlags fmath = {});
 
+  Op getOp() const { return op; }
+  unsigned getFlags() const { return flags; }
+  Value& getLhs() const { return *lhs; }
+  Value& getRhs() const { return *rhs; }
+
   std::vector<Value*> operands() const override;
   bool propagatesPoison() const override;
   void rauw(const Value &what, Value &with) override;
@@ -125,6 +130,8 @@ public:
   TernaryOp(Type &type, std::string &&name, Value &a, Value &b, Value &c, Op op,
             FastMathFlags fmath = {});
 
+  Op getOp() const { return op; }
+
   std::vector<Value*> operands() const override;
   bool propagatesPoison() const override;
   void rauw(const Value &what, Value &with) override;
@@ -168,6 +175,7 @@ public:
          FastMathFlags fmath = {})
     : Instr(type, std::move(name)), cond(&cond), a(&a), b(&b), fmath(fmath) {}
 
+  Value *getCond() const { return cond; }
   Value *getTrueValue() const { return a; }
   Value *getFalseValue() const { return b; }
 
@@ -420,6 +428,8 @@ public:
   Assume(Value &cond, Kind kind);
   Assume(std::vector<Value *> &&args, Kind kind);
 
+  Kind getKind() const { return kind; }
+
   std::vector<Value*> operands() const override;
   void rauw(const Value &what, Value &with) override;
   void print(std::ostream &os) const override;
@@ -482,6 +492,7 @@ public:
 
   Value& getSize() const { return *size; }
   Value* getMul() const { return mul; }
+  unsigned getAlign() const { return align; }
   bool initDead() const { return initially_dead; }
   void markAsInitiallyDead() { initially_dead = true; }
 
@@ -591,6 +602,8 @@ public:
   Free(Value &ptr, bool heaponly = true) : MemInstr(Type::voidTy, "free"),
       ptr(&ptr), heaponly(heaponly) {}
 
+  bool isHeapOnly() const { return heaponly; }
+
   std::pair<uint64_t, unsigned> getMaxAllocSize() const override;
   uint64_t getMaxAccessSize() const override;
   uint64_t getMaxGEPOffset() const override;
@@ -742,6 +755,8 @@ public:
     : MemInstr(Type::voidTy, "memcpy"), dst(&dst), src(&src), bytes(&bytes),
             align_dst(align_dst), align_src(align_src), move(move) {}
 
+  Value& getDst() const { return *dst; }
+  Value& getSrc() const { return *src; }
   Value& getBytes() const { return *bytes; }
   unsigned getSrcAlign() const { return align_src; }
   unsigned getDstAlign() const { return align_dst; }
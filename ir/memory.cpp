@@ -7,7 +7,9 @@
 #include "ir/value.h"
 #include "smt/solver.h"
 #include "util/compiler.h"
+#include "util/config.h"
 #include <array>
+#include <atomic>
 #include <numeric>
 #include <string>
 
@@ -99,9 +101,9 @@ static bool always_nowrite(unsigned bid) {
 }
 
 
-static unsigned next_local_bid;
-static unsigned next_global_bid;
-static unsigned next_ptr_input;
+static thread_local unsigned next_local_bid;
+static thread_local unsigned next_global_bid;
+static thread_local unsigned next_ptr_input;
 
 static bool byte_has_ptr_bit() {
   return does_int_mem_access && does_ptr_mem_access;
@@ -586,8 +588,10 @@ void Memory::AliasSet::unionWith(const AliasSet &other) {
 }
 
 static const array<uint64_t, 5> alias_buckets_vals = { 1, 2, 3, 5, 10 };
-static array<uint64_t, 6> alias_buckets_hits = { 0 };
-static uint64_t only_local = 0, only_nonlocal = 0;
+static array<atomic<uint64_t>, 6> alias_buckets_hits = { 0 };
+static atomic<uint64_t> only_local = 0, only_nonlocal = 0;
+// accesses to local blocks by their encoding
+static atomic<uint64_t> num_flat_accesses = 0, num_array_accesses = 0;
 
 void Memory::AliasSet::computeAccessStats() const {
   auto nlocal = numMayAlias(true);
@@ -619,6 +623,14 @@ void Memory::AliasSet::printStats(ostream &os) {
   os.precision(1);
   os << fixed;
 
+  if (double local_total = (num_flat_accesses + num_array_accesses) / 100.0) {
+    os << "\n\nLocal block encoding\n====================\n"
+          "Bit-vector: " << num_flat_accesses
+       << " (" << (num_flat_accesses / local_total)
+       << "%)\nArray:      " << num_array_accesses
+       << " (" << (num_array_accesses / local_total) << "%)";
+  }
+
   os << "\n\nAlias sets statistics\n=====================\n"
         "Only local:     " << only_local
      << " (" << (only_local / total)
@@ -833,10 +845,18 @@ void Memory::access(const Pointer &ptr, unsigned bytes, unsigned align,
   auto sz_local = aliasing.size(true);
   auto sz_nonlocal = aliasing.size(false);
 
+  // only copy shared blocks if fn may modify them
+  auto blk = [](cow<MemBlock> &b) -> auto& {
+    if constexpr (is_invocable_v<Fn&, const MemBlock&, unsigned, bool, expr>)
+      return *b;
+    else
+      return b.write();
+  };
+
   for (unsigned i = 0; i < sz_local; ++i) {
     if (aliasing.mayAlias(true, i)) {
       auto n = expr::mkUInt(i, Pointer::bitsShortBid());
-      fn(local_block_val[i], i, true,
+      fn(blk(local_block_val[i]), i, true,
          is_singleton ? true
                       : (has_local == 1
                            ? is_local
@@ -851,12 +871,96 @@ void Memory::access(const Pointer &ptr, unsigned bytes, unsigned align,
       // If aliasing info says it can, either imprecise analysis or incorrect
       // block id encoding is happening.
       assert(!is_fncall_mem(i));
-      fn(non_local_block_val[i], i, false,
+      fn(blk(non_local_block_val[i]), i, false,
          is_singleton ? true : (has_nonlocal == 1 ? !is_local : bid == i));
     }
   }
 }
 
+// Loads idx from a block value, forwarding the stored values through the
+// ite(cond, store(.., blk), blk) chains built by Memory::store() when the
+// offsets are known at encoding time. Falls back to an array read otherwise.
+static expr load_forward(const expr &val, const expr &idx,
+                         map<expr, expr> &cache) {
+  auto [I, inserted] = cache.try_emplace(val);
+  if (!inserted)
+    return I->second;
+
+  expr ret, array, str_idx, str_val, cond, then, els;
+  if (val.isStore(array, str_idx, str_val)) {
+    expr cmp = idx == str_idx;
+    if (cmp.isTrue())
+      ret = move(str_val);
+    else if (cmp.isFalse())
+      ret = load_forward(array, idx, cache);
+  } else if (val.isIf(cond, then, els)) {
+    auto a = load_forward(then, idx, cache);
+    ret = expr::mkIf(cond, a, load_forward(els, idx, cache));
+  }
+
+  if (!ret.isValid())
+    ret = val.load(idx);
+  I->second = ret;
+  return ret;
+}
+
+// Local blocks of a small known size are encoded as a bit-vector with one
+// Byte per short offset instead of an array while they are only written at
+// constant offsets. Byte i is in bits [(i+1)*bitsByte()-1, i*bitsByte()].
+static constexpr uint64_t max_flat_block_bytes = 16;
+
+static unsigned flat_num_bytes(const expr &flat) {
+  return flat.bits() / Byte::bitsByte();
+}
+
+static expr flat_load(const Memory &m, const expr &flat, const expr &idx) {
+  unsigned bits = Byte::bitsByte();
+  uint64_t n = flat_num_bytes(flat), i;
+  if (idx.isUInt(i))
+    return i < n ? flat.extract((i+1) * bits - 1, i * bits)
+                 : Byte::mkPoisonByte(m)();
+
+  expr ret = Byte::mkPoisonByte(m)();
+  for (i = 0; i < n; ++i) {
+    ret = expr::mkIf(idx == i, flat.extract((i+1) * bits - 1, i * bits), ret);
+  }
+  return ret;
+}
+
+static expr mk_flat(const vector<expr> &bytes) {
+  expr ret = bytes.back();
+  for (auto I = next(bytes.rbegin()), E = bytes.rend(); I != E; ++I) {
+    ret = ret.concat(*I);
+  }
+  return ret;
+}
+
+static vector<expr> to_flat_bytes(const Memory &m, const expr &val,
+                                  uint64_t n) {
+  vector<expr> bytes;
+  for (uint64_t i = 0; i < n; ++i) {
+    auto idx = expr::mkUInt(i, Pointer::bitsShortOffset());
+    map<expr, expr> cache;
+    bytes.emplace_back(val.isBV() ? flat_load(m, val, idx)
+                                  : load_forward(val, idx, cache));
+  }
+  return bytes;
+}
+
+static expr to_array(const Memory &m, const expr &val) {
+  if (!val.isBV())
+    return val;
+
+  expr ret
+    = expr::mkConstArray(expr::mkUInt(0, Pointer::bitsShortOffset()),
+                         Byte::mkPoisonByte(m)());
+  for (unsigned i = 0, e = flat_num_bytes(val); i != e; ++i) {
+    ret = ret.store(expr::mkUInt(i, Pointer::bitsShortOffset()),
+                    flat_load(m, val, expr::mkUInt(i, 64)));
+  }
+  return ret;
+}
+
 vector<Byte> Memory::load(const Pointer &ptr, unsigned bytes, set<expr> &undef,
                           unsigned align, bool left2right, DataType type) {
   if (bytes == 0)
@@ -872,11 +976,18 @@ vector<Byte> Memory::load(const Pointer &ptr, unsigned bytes, set<expr> &undef,
 
   auto fn = [&](const MemBlock &blk, unsigned bid, bool local, expr &&cond) {
     bool is_poison = (type & blk.type) == DATA_NONE;
+    bool is_flat = blk.val.isBV();
+    if (local)
+      ++(is_flat ? num_flat_accesses : num_array_accesses);
+
     for (unsigned i = 0; i < loaded_bytes; ++i) {
       unsigned idx = left2right ? i : (loaded_bytes - i - 1);
       expr off = offset + expr::mkUInt(idx, off_bits);
+      map<expr, expr> cache;
       loaded[i].add(is_poison ? Byte::mkPoisonByte(*this)()
-                              : blk.val.load(off), cond);
+                              : (is_flat ? flat_load(*this, blk.val, off)
+                                         : load_forward(blk.val, off, cache)),
+                    cond);
       if (!is_poison)
         undef.insert(blk.undef.begin(), blk.undef.end());
     }
@@ -937,14 +1048,41 @@ void Memory::store(const Pointer &ptr,
   auto stored_ty_full = data_type(data, true);
 
   auto fn = [&](MemBlock &blk, unsigned bid, bool local, expr &&cond) {
-    auto mem = blk.val;
+    uint64_t blk_size, off;
+    bool has_size = Pointer(*this, bid, local).blockSize().isUInt(blk_size);
+    bool flat = local && has_size && offset.isUInt(off) &&
+                blk_size >= bits_byte / 8 &&
+                blk_size <= max_flat_block_bytes &&
+                blk_size % (bits_byte / 8) == 0;
+    if (local)
+      ++(flat ? num_flat_accesses : num_array_accesses);
+
+    if (flat) {
+      auto flat_bytes = to_flat_bytes(*this, blk.val, blk_size / (bits_byte/8));
+      for (auto &[idx, val] : data) {
+        uint64_t i = off + (idx >> Pointer::zeroBitsShortOffset());
+        // out-of-bounds stores are UB
+        if (i < flat_bytes.size())
+          flat_bytes[i] = expr::mkIf(cond, val, flat_bytes[i]);
+      }
+      blk.val = mk_flat(flat_bytes);
+      if (cond.isTrue() && blk_size == bytes) {
+        blk.undef.clear();
+        blk.type = stored_ty_full;
+      } else {
+        blk.type |= blk_size == bytes ? stored_ty_full : stored_ty;
+      }
+      blk.undef.insert(undef.begin(), undef.end());
+      return;
+    }
+
+    auto mem = to_array(*this, blk.val);
+    blk.val = mem;
 
-    uint64_t blk_size;
     bool full_write = false;
     // optimization: if fully rewriting the block, don't bother with the old
     // contents. Pick a value as the default one.
-    if (Pointer(*this, bid, local).blockSize().isUInt(blk_size) &&
-        blk_size == bytes) {
+    if (has_size && blk_size == bytes) {
       mem = expr::mkConstArray(offset, data[0].second);
       full_write = true;
       if (cond.isTrue()) {
@@ -983,6 +1121,7 @@ void Memory::storeLambda(const Pointer &ptr, const expr &offset,
   auto stored_ty = data_type({{ 0, val }}, false);
 
   auto fn = [&](MemBlock &blk, unsigned bid, bool local, expr &&cond) {
+    blk.val = to_array(*this, blk.val);
     // optimization: full rewrite
     if (bytes.eq(Pointer(*this, bid, local).blockSize())) {
       blk.val = val_no_offset
@@ -1035,7 +1174,7 @@ void Memory::mkNonlocalValAxioms(bool skip_consts) {
 
   for (unsigned i = has_null_block + skip_consts * num_consts_src,
        e = numNonlocals(); i != e; ++i) {
-    Byte byte(*this, non_local_block_val[i].val.load(offset));
+    Byte byte(*this, non_local_block_val[i]->val.load(offset));
     Pointer loadedptr = byte.ptr();
     expr bid = loadedptr.getShortBid();
 
@@ -1072,7 +1211,7 @@ Memory::Memory(State &state) : state(&state), escaped_local_blks(*this) {
 
   // TODO: should skip initialization of fully initialized constants
   for (unsigned bid = has_null_block, e = numNonlocals(); bid != e; ++bid) {
-    non_local_block_val.emplace_back(mk_block_val_array(bid));
+    non_local_block_val.emplace_back(MemBlock(mk_block_val_array(bid)));
   }
 
   non_local_block_liveness = mk_liveness_array();
@@ -1087,7 +1226,8 @@ Memory::Memory(State &state) : state(&state), escaped_local_blks(*this) {
     auto poison_array
       = expr::mkConstArray(expr::mkUInt(0, Pointer::bitsShortOffset()),
                            Byte::mkPoisonByte(*this)());
-    local_block_val.resize(numLocals(), { move(poison_array), DATA_NONE });
+    local_block_val.resize(numLocals(),
+                           MemBlock(move(poison_array), DATA_NONE));
 
     // all local blocks are dead in the beginning
     local_block_liveness = expr::mkUInt(0, numLocals());
@@ -1216,6 +1356,34 @@ expr Memory::mkInput(const char *name, const ParamAttrs &attrs) {
   return p.release();
 }
 
+void Memory::restrictAlias(const expr &ptr, const vector<expr> &ptrs) {
+  AliasSet alias(*this);
+  for (auto &e : ptrs) {
+    for (auto &p : all_leaf_ptrs(*this, e)) {
+      auto is_local = p.isLocal();
+      uint64_t bid;
+      if (is_local.isConst() && p.getShortBid().isUInt(bid)) {
+        if (bid < alias.size(is_local.isTrue()))
+          alias.setMayAlias(is_local.isTrue(), bid);
+        continue;
+      }
+      auto I = ptr_alias.find(p.getBid());
+      if (I == ptr_alias.end())
+        return;
+      alias.unionWith(I->second);
+    }
+  }
+
+  for (auto &p : all_leaf_ptrs(*this, ptr)) {
+    auto bid = p.getBid();
+    if (bid.isConst())
+      continue;
+    auto [I, inserted] = ptr_alias.try_emplace(bid, alias);
+    if (!inserted)
+      I->second.intersectWith(alias);
+  }
+}
+
 pair<expr, expr> Memory::mkUndefInput(const ParamAttrs &attrs) const {
   bool nonnull = attrs.has(ParamAttrs::NonNull);
   unsigned log_offset = ilog2_ceil(bits_for_offset, false);
@@ -1323,7 +1491,7 @@ Memory::mkCallState(const string &fnname, const vector<PtrInput> *ptr_inputs,
       }
 
       auto &new_val = st.non_local_block_val[bid - num_consts];
-      auto &old_val = non_local_block_val[bid].val;
+      auto &old_val = non_local_block_val[bid]->val;
       new_val = expr::mkIf(modifies, new_val, old_val);
     }
   }
@@ -1364,9 +1532,10 @@ void Memory::setState(const Memory::CallState &st) {
   assert(has_fncall);
   auto consts = has_null_block + num_consts_src;
   for (unsigned i = consts; i < num_nonlocals_src; ++i) {
-    non_local_block_val[i].val = st.non_local_block_val[i - consts];
-    if (isInitialMemBlock(non_local_block_val[i].val, true))
-      non_local_block_val[i].undef.clear();
+    auto &blk = non_local_block_val[i].write();
+    blk.val = st.non_local_block_val[i - consts];
+    if (isInitialMemBlock(blk.val, true))
+      blk.undef.clear();
   }
   non_local_block_liveness = st.non_local_liveness;
   mkNonlocalValAxioms(true);
@@ -1662,6 +1831,19 @@ Byte Memory::load(const Pointer &p, set<expr> &undef) {
   return move(load(p, bits_byte / 8, undef, 1)[0]);
 }
 
+// Whether a memset/memcpy of n bytes should be lowered to byte stores rather
+// than to a lambda. Lambdas introduce a quantified offset, so small copies and
+// copies at constant offsets up to the configured size are unrolled.
+static bool unroll_memop(uint64_t n, const Pointer &dst,
+                         const Pointer *src = nullptr) {
+  unsigned bytesz = bits_byte / 8;
+  if (n / bytesz <= 4)
+    return true;
+  return n <= util::config::memop_unroll_bytes &&
+         dst.getShortOffset().isConst() &&
+         (!src || src->getShortOffset().isConst());
+}
+
 void Memory::memset(const expr &p, const StateValue &val, const expr &bytesize,
                     unsigned align, const set<expr> &undef_vars,
                     bool deref_check) {
@@ -1683,7 +1865,7 @@ void Memory::memset(const expr &p, const StateValue &val, const expr &bytesize,
   expr raw_byte = move(bytes[0])();
 
   uint64_t n;
-  if (bytesize.isUInt(n) && (n / bytesz) <= 4) {
+  if (bytesize.isUInt(n) && unroll_memop(n, ptr)) {
     vector<pair<unsigned, expr>> to_store;
     for (unsigned i = 0; i < n; i += bytesz) {
       to_store.emplace_back(i, raw_byte);
@@ -1712,7 +1894,7 @@ void Memory::memcpy(const expr &d, const expr &s, const expr &bytesize,
     return;
 
   uint64_t n;
-  if (bytesize.isUInt(n) && (n / bytesz) <= 4) {
+  if (bytesize.isUInt(n) && unroll_memop(n, dst, &src)) {
     vector<pair<unsigned, expr>> to_store;
     set<expr> undef;
     unsigned i = 0;
@@ -1744,18 +1926,19 @@ void Memory::copy(const Pointer &src, const Pointer &dst) {
   bool dst_local = local.isTrue();
   uint64_t dst_bid;
   ENSURE(dst.getShortBid().isUInt(dst_bid));
-  auto &dst_blk = (dst_local ? local_block_val : non_local_block_val)[dst_bid];
+  auto &dst_blk
+    = (dst_local ? local_block_val : non_local_block_val)[dst_bid].write();
   dst_blk.undef.clear();
   dst_blk.type = DATA_NONE;
 
   auto offset = expr::mkUInt(0, Pointer::bitsShortOffset());
   DisjointExpr val(expr::mkConstArray(offset, Byte::mkPoisonByte(*this)()));
 
-  auto fn = [&](MemBlock &blk, unsigned bid, bool local, expr &&cond) {
+  auto fn = [&](const MemBlock &blk, unsigned bid, bool local, expr &&cond) {
     // we assume src != dst
     if (local == dst_local && bid == dst_bid)
       return;
-    val.add(blk.val, move(cond));
+    val.add(to_array(*this, blk.val), move(cond));
     dst_blk.undef.insert(blk.undef.begin(), blk.undef.end());
     dst_blk.type |= blk.type;
   };
@@ -1787,8 +1970,8 @@ expr Memory::int2ptr(const expr &val) const {
 expr Memory::blockValRefined(const Memory &other, unsigned bid, bool local,
                              const expr &offset, set<expr> &undef) const {
   assert(!local);
-  auto &mem1 = non_local_block_val[bid];
-  auto &mem2 = other.non_local_block_val[bid].val;
+  auto &mem1 = *non_local_block_val[bid];
+  auto &mem2 = other.non_local_block_val[bid]->val;
 
   if (mem1.val.eq(mem2))
     return true;
@@ -1862,7 +2045,8 @@ expr Memory::blockRefined(const Pointer &src, const Pointer &tgt, unsigned bid,
 tuple<expr, Pointer, set<expr>>
 Memory::refined(const Memory &other, bool skip_constants,
                 const vector<PtrInput> *set_ptrs,
-                const vector<PtrInput> *set_ptrs2) const {
+                const vector<PtrInput> *set_ptrs2,
+                vector<pair<unsigned, expr>> *per_block) const {
   if (num_nonlocals <= has_null_block)
     return { true, Pointer(*this, expr()), {} };
 
@@ -1887,7 +2071,11 @@ Memory::refined(const Memory &other, bool skip_constants,
     Pointer q(other, p());
     if (p.isByval().isTrue() && q.isByval().isTrue())
       continue;
-    ret &= (ptr_bid == bid_expr).implies(blockRefined(p, q, bid, undef_vars));
+    auto block
+      = (ptr_bid == bid_expr).implies(blockRefined(p, q, bid, undef_vars));
+    ret &= block;
+    if (per_block && !block.isTrue())
+      per_block->emplace_back(bid, move(block));
   }
 
   // restrict refinement check to set of request blocks
@@ -1899,6 +2087,11 @@ Memory::refined(const Memory &other, bool skip_constants,
       c |= ptr.non_poison && Pointer(*this, ptr.value).getBid() == ptr_bid;
     }
     ret = c.implies(ret);
+    if (per_block) {
+      for (auto &[bid, block] : *per_block) {
+        block = c.implies(block);
+      }
+    }
   }
 
   return { move(ret), move(ptr), move(undef_vars) };
@@ -1915,7 +2108,7 @@ expr Memory::checkNocapture() const {
   for (unsigned bid = has_null_block + num_consts_src; bid < numNonlocals();
        ++bid) {
     Pointer p(*this, bid, false);
-    Byte b(*this, non_local_block_val[bid].val.load(offset));
+    Byte b(*this, non_local_block_val[bid]->val.load(offset));
     Pointer loadp(*this, b.ptrValue());
     res &= (p.isBlockAlive() && b.isPtr() && b.ptrNonpoison())
              .implies(!loadp.isNocapture());
@@ -1949,20 +2142,26 @@ void Memory::escapeLocalPtr(const expr &ptr) {
 Memory Memory::mkIf(const expr &cond, const Memory &then, const Memory &els) {
   assert(then.state == els.state);
   Memory ret(then);
+  // blocks that weren't written on either side are still shared
+  auto merge = [&](cow<MemBlock> &blk, const cow<MemBlock> &other) {
+    if (blk.shares(other))
+      return;
+    auto &b = blk.write();
+    // a block may be flat on one side only
+    if (b.val.isBV() && other->val.isBV() &&
+        b.val.bits() == other->val.bits())
+      b.val = expr::mkIf(cond, b.val, other->val);
+    else
+      b.val = expr::mkIf(cond, to_array(then, b.val),
+                         to_array(then, other->val));
+    b.undef.insert(other->undef.begin(), other->undef.end());
+  };
   for (unsigned bid = has_null_block + num_consts_src, end = ret.numNonlocals();
        bid < end; ++bid) {
-    auto &other = els.non_local_block_val[bid];
-    ret.non_local_block_val[bid].val
-      = expr::mkIf(cond, then.non_local_block_val[bid].val, other.val);
-    ret.non_local_block_val[bid].undef.insert(other.undef.begin(),
-                                              other.undef.end());
+    merge(ret.non_local_block_val[bid], els.non_local_block_val[bid]);
   }
   for (unsigned bid = 0, end = ret.numLocals(); bid < end; ++bid) {
-    auto &other = els.local_block_val[bid];
-    ret.local_block_val[bid].val
-      = expr::mkIf(cond, then.local_block_val[bid].val, other.val);
-    ret.local_block_val[bid].undef.insert(other.undef.begin(),
-                                          other.undef.end());
+    merge(ret.local_block_val[bid], els.local_block_val[bid]);
   }
   ret.non_local_block_liveness = expr::mkIf(cond, then.non_local_block_liveness,
                                             els.non_local_block_liveness);
@@ -2051,10 +2250,10 @@ ostream& operator<<(ostream &os, const Memory &m) {
   os << "\n\nMEMORY\n======\n"
         "BLOCK VALUE:";
   for (unsigned i = 0; i < m.numLocals(); ++i)
-    os << "\nLocal BLK " << i << ":\t" << m.local_block_val[i].val.simplify();
+    os << "\nLocal BLK " << i << ":\t" << m.local_block_val[i]->val.simplify();
   for (unsigned i = 0; i < m.numNonlocals(); ++i)
     os << "\nNonLocal BLK " << i << ":\t"
-       << m.non_local_block_val[i].val.simplify();
+       << m.non_local_block_val[i]->val.simplify();
   os << '\n';
   P("BLOCK LIVENESS:", local_block_liveness, non_local_block_liveness);
   P("BLOCK SIZE:", local_blk_size, non_local_blk_size);
@@ -8,6 +8,7 @@
 #include "ir/type.h"
 #include "smt/expr.h"
 #include "smt/exprs.h"
+#include "util/cow.h"
 #include "util/spaceship.h"
 #include <compare>
 #include <map>
@@ -129,8 +130,10 @@ class Memory {
     std::weak_ordering operator<=>(const MemBlock &rhs) const;
   };
 
-  std::vector<MemBlock> non_local_block_val;
-  std::vector<MemBlock> local_block_val;
+  // blocks are shared with the memories this one was copied from until
+  // either of them writes to it
+  std::vector<util::cow<MemBlock>> non_local_block_val;
+  std::vector<util::cow<MemBlock>> local_block_val;
 
   smt::expr non_local_block_liveness; // BV w/ 1 bit per bid (1 if live)
   smt::expr local_block_liveness;
@@ -243,6 +246,8 @@ public:
   };
 
   smt::expr mkFnRet(const char *name, const std::vector<PtrInput> &ptr_inputs);
+  // ptr may only point to the blocks of the given pointers
+  void restrictAlias(const smt::expr &ptr, const std::vector<smt::expr> &ptrs);
   CallState mkCallState(const std::string &fnname,
                         const std::vector<PtrInput> *ptr_inputs, bool nofree);
   void setState(const CallState &st);
@@ -290,10 +295,14 @@ public:
   smt::expr ptr2int(const smt::expr &ptr) const;
   smt::expr int2ptr(const smt::expr &val) const;
 
+  // If per_block is given, it's filled with the refinement constraint of each
+  // block; the returned constraint is the conjunction of these.
   std::tuple<smt::expr, Pointer, std::set<smt::expr>>
     refined(const Memory &other, bool fncall,
             const std::vector<PtrInput> *set_ptrs = nullptr,
-            const std::vector<PtrInput> *set_ptrs_other = nullptr) const;
+            const std::vector<PtrInput> *set_ptrs_other = nullptr,
+            std::vector<std::pair<unsigned, smt::expr>> *per_block = nullptr)
+      const;
 
   // Returns true if a nocapture pointer byte is not in the memory.
   smt::expr checkNocapture() const;
@@ -0,0 +1,204 @@
+// Copyright (c) 2018-present The Alive2 Authors.
+// Distributed under the MIT license that can be found in the LICENSE file.
+
+#include "ir/points_to.h"
+#include "ir/function.h"
+#include "ir/instr.h"
+#include <map>
+
+using namespace std;
+
+namespace {
+struct PtrSet {
+  bool top = false; // may point anywhere
+  IR::PointsTo::Sites sites;
+
+  bool add(const PtrSet &other) {
+    if (top)
+      return false;
+    if (other.top) {
+      top = true;
+      sites.clear();
+      return true;
+    }
+    auto sz = sites.size();
+    sites.insert(other.sites.begin(), other.sites.end());
+    return sites.size() != sz;
+  }
+};
+}
+
+static bool is_local_site(const IR::Value &v) {
+  return dynamic_cast<const IR::Alloc*>(&v) ||
+         dynamic_cast<const IR::Malloc*>(&v) ||
+         dynamic_cast<const IR::Calloc*>(&v);
+}
+
+static bool is_site(const IR::Value &v) {
+  return is_local_site(v) || dynamic_cast<const IR::GlobalVariable*>(&v) ||
+         dynamic_cast<const IR::Input*>(&v);
+}
+
+// values that may become pointers to arbitrary blocks, including locals whose
+// address is never exposed
+static bool may_forge_ptr(const IR::Instr &i) {
+  if (IR::isCast(IR::ConversionOp::Int2Ptr, i))
+    return true;
+  if (dynamic_cast<const IR::Freeze*>(&i) && !i.getType().isIntType() &&
+      !i.getType().isFloatType())
+    return true;
+  for (auto op : i.operands()) {
+    if (dynamic_cast<const IR::UndefValue*>(op) && !op->getType().isIntType() &&
+        !op->getType().isFloatType())
+      return true;
+  }
+  return false;
+}
+
+namespace IR {
+
+PointsTo::PointsTo(const Function &f) {
+  for (auto &i : f.instrs()) {
+    if (may_forge_ptr(i))
+      return;
+  }
+
+  map<const Value*, PtrSet> vals;
+  map<const Value*, PtrSet> contents; // local site -> stored pointers
+  set<const Value*> escaped;
+  bool changed = true;
+
+  auto get = [&](const Value &v) -> PtrSet {
+    if (is_site(v))
+      return { false, { &v } };
+    if (dynamic_cast<const NullPointerValue*>(&v))
+      return {};
+    if (auto I = vals.find(&v); I != vals.end())
+      return I->second;
+    // instructions not visited yet start empty
+    return { !dynamic_cast<const Instr*>(&v), {} };
+  };
+
+  auto escape = [&](const PtrSet &s) {
+    for (auto site : s.sites) {
+      if (is_local_site(*site))
+        changed |= escaped.emplace(site).second;
+    }
+  };
+
+  // escapes all pointers within v
+  auto escape_value = [&](const Value &v) {
+    vector<const Value*> todo = { &v };
+    do {
+      auto *val = todo.back();
+      todo.pop_back();
+      if (val->getType().isPtrType())
+        escape(get(*val));
+      else if (auto agg = dynamic_cast<const AggregateValue*>(val))
+        todo.insert(todo.end(), agg->getVals().begin(), agg->getVals().end());
+    } while (!todo.empty());
+  };
+
+  auto load = [&](const PtrSet &ptr) {
+    if (ptr.top)
+      return PtrSet{ true, {} };
+    PtrSet ret;
+    for (auto site : ptr.sites) {
+      if (!is_local_site(*site) || escaped.count(site))
+        return PtrSet{ true, {} };
+      ret.add(contents[site]);
+    }
+    return ret;
+  };
+
+  auto store = [&](const PtrSet &ptr, const PtrSet &val) {
+    if (ptr.top) {
+      escape(val);
+      return;
+    }
+    for (auto site : ptr.sites) {
+      if (!is_local_site(*site) || escaped.count(site))
+        escape(val);
+      else
+        changed |= contents[site].add(val);
+    }
+  };
+
+  auto set_val = [&](const Instr &i, const PtrSet &s) {
+    changed |= vals[&i].add(s);
+  };
+
+  while (changed) {
+    changed = false;
+
+    for (auto &i : f.instrs()) {
+      if (is_local_site(i))
+        continue;
+
+      bool is_ptr = i.getType().isPtrType();
+      if (auto gep = dynamic_cast<const GEP*>(&i); gep && is_ptr) {
+        set_val(i, get(gep->getPtr()));
+      } else if (auto op = isNoOp(i); op && is_ptr) {
+        set_val(i, get(*op));
+      } else if (auto phi = dynamic_cast<const Phi*>(&i); phi && is_ptr) {
+        for (auto op : phi->operands()) {
+          set_val(i, get(*op));
+        }
+      } else if (auto sel = dynamic_cast<const Select*>(&i); sel && is_ptr) {
+        set_val(i, get(*sel->getTrueValue()));
+        set_val(i, get(*sel->getFalseValue()));
+      } else if (auto ld = dynamic_cast<const Load*>(&i)) {
+        auto ptr = get(ld->getPtr());
+        if (is_ptr) {
+          set_val(i, load(ptr));
+        } else if (!i.getType().isIntType() && !i.getType().isFloatType()) {
+          // the pointers within aggregates are not tracked
+          escape(load(ptr));
+        }
+      } else if (auto st = dynamic_cast<const Store*>(&i)) {
+        auto &val = st->getValue();
+        if (val.getType().isPtrType()) {
+          store(get(st->getPtr()), get(val));
+        } else {
+          escape_value(val);
+          // the pointers within aggregates are not tracked
+          if (hasPtr(val.getType()))
+            store(get(st->getPtr()), { true, {} });
+        }
+      } else if (auto cpy = dynamic_cast<const Memcpy*>(&i)) {
+        store(get(cpy->getDst()), load(get(cpy->getSrc())));
+      } else if (dynamic_cast<const Memset*>(&i) ||
+                 dynamic_cast<const Memcmp*>(&i) ||
+                 dynamic_cast<const Strlen*>(&i) ||
+                 dynamic_cast<const Free*>(&i) ||
+                 dynamic_cast<const StartLifetime*>(&i) ||
+                 dynamic_cast<const FillPoison*>(&i) ||
+                 dynamic_cast<const ICmp*>(&i)) {
+        // don't store pointers nor let them escape
+      } else {
+        for (auto op : i.operands()) {
+          escape_value(*op);
+        }
+        if (is_ptr)
+          set_val(i, { true, {} });
+      }
+    }
+
+    // the contents of escaped blocks may be read by anyone
+    for (auto site : vector<const Value*>(escaped.begin(), escaped.end())) {
+      escape(contents[site]);
+    }
+  }
+
+  for (auto &[v, s] : vals) {
+    if (!s.top)
+      pts.emplace(v, move(s.sites));
+  }
+}
+
+const PointsTo::Sites* PointsTo::get(const Value &v) const {
+  auto I = pts.find(&v);
+  return I == pts.end() ? nullptr : &I->second;
+}
+
+}
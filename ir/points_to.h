@@ -0,0 +1,34 @@
+#pragma once
+
+// Copyright (c) 2018-present The Alive2 Authors.
+// Distributed under the MIT license that can be found in the LICENSE file.
+
+#include <set>
+#include <unordered_map>
+
+namespace IR {
+
+class Function;
+class Value;
+
+// Flow-insensitive points-to analysis. Computes, for each pointer, the
+// allocation sites (allocas, mallocs, globals, and inputs) it may point to.
+// Pointers stored in local blocks whose address doesn't escape are tracked
+// through memory; anything loaded from other blocks may point anywhere.
+class PointsTo {
+public:
+  using Sites = std::set<const Value*>;
+
+private:
+  // pointers that are missing may point anywhere
+  std::unordered_map<const Value*, Sites> pts;
+
+public:
+  PointsTo() = default;
+  PointsTo(const Function &f);
+
+  // nullptr if v may point anywhere
+  const Sites* get(const Value &v) const;
+};
+
+}
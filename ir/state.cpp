@@ -5,7 +5,10 @@
 #include "ir/function.h"
 #include "ir/globals.h"
 #include "smt/smt.h"
+#include "smt/solver.h"
+#include "util/config.h"
 #include "util/errors.h"
+#include "util/trace.h"
 #include <cassert>
 
 using namespace smt;
@@ -22,18 +25,23 @@ State::CurrentDomain::operator bool() const {
   return !path.isFalse() && UB;
 }
 
-template<class T>
-static T intersect_set(const T &a, const T &b) {
-  T results;
-  set_intersection(a.begin(), a.end(), b.begin(), b.end(),
-                   inserter(results, results.begin()));
-  return results;
-}
-
 void State::ValueAnalysis::intersect(const State::ValueAnalysis &other) {
-  non_poison_vals = intersect_set(non_poison_vals, other.non_poison_vals);
-  non_undef_vals = intersect_set(non_undef_vals, other.non_undef_vals);
-  unused_vars = intersect_set(unused_vars, other.unused_vars);
+  non_poison_vals &= other.non_poison_vals;
+  unused_vars &= other.unused_vars;
+
+  // a var is non-undef only if both paths replaced it with the same value
+  non_undef_vals &= other.non_undef_vals;
+  for (auto I = non_undef_exprs.begin(); I != non_undef_exprs.end(); ) {
+    if (non_undef_vals.count(I->first)) {
+      auto OI = other.non_undef_exprs.find(I->first);
+      if (OI->second.eq(I->second)) {
+        ++I;
+        continue;
+      }
+      non_undef_vals.erase(I->first);
+    }
+    I = non_undef_exprs.erase(I);
+  }
 
   for (auto &[fn, interval] : other.ranges_fn_calls) {
     auto [I, inserted] = ranges_fn_calls.try_emplace(fn, 0, interval.second);
@@ -112,12 +120,34 @@ void State::resetGlobals() {
   Memory::resetGlobals();
 }
 
+static StateValue mk_abstract_value(const Value &v) {
+  auto dummy = v.getType().getDummyValue(true);
+  auto name = "#abstract" + v.getName();
+  return { expr::mkVar(name.c_str(), dummy.value),
+           expr::mkVar((name + "#np").c_str(), dummy.non_poison) };
+}
+
 const StateValue& State::exec(const Value &v) {
   assert(undef_vars.empty());
-  auto val = v.toSMT(*this);
-  ENSURE(values_map.try_emplace(&v, (unsigned)values.size()).second);
+  bool is_abstract = abstract_values.count(&v);
+  auto val = is_abstract ? mk_abstract_value(v) : v.toSMT(*this);
+
+  auto sites = points_to.get(v);
+  if (sites && !is_abstract && val.value.isValid()) {
+    vector<expr> ptrs;
+    for (auto site : *sites) {
+      // sites not executed yet can't be pointed to
+      auto I = values_map.find(site);
+      if (I != values_map.end())
+        ptrs.emplace_back(get<1>(values[I->second]).first.value);
+    }
+    memory.restrictAlias(val.value, ptrs);
+  }
+
+  unsigned idx = values.size();
+  ENSURE(values_map.try_emplace(&v, idx).second);
   values.emplace_back(&v, ValTy(move(val), move(undef_vars)));
-  analysis.unused_vars.insert(&v);
+  analysis.unused_vars.insert(idx);
 
   // cleanup potentially used temporary values due to undef rewriting
   while (i_tmp_values > 0) {
@@ -223,7 +253,8 @@ expr State::strip_undef_and_add_ub(const Value &val, const expr &e) {
     auto name = var.fn_name();
     for (auto &v : values_map) {
       if (v.first->getName() == name) {
-        analysis.non_undef_vals.emplace(v.first, var);
+        if (analysis.non_undef_vals.insert(v.second))
+          analysis.non_undef_exprs.emplace(v.second, var);
         return;
       }
     }
@@ -342,34 +373,28 @@ expr State::strip_undef_and_add_ub(const Value &val, const expr &e) {
   return e;
 }
 
-StateValue* State::no_more_tmp_slots() {
-  if (i_tmp_values < tmp_values.size())
-    return nullptr;
-  throw AliveException("Too many temporaries", false);
+StateValue& State::newTmpValue(StateValue &&v) {
+  // slots are reused across instructions; only grow when all are in use
+  if (i_tmp_values == tmp_values.size())
+    tmp_values.emplace_back();
+  return tmp_values[i_tmp_values++] = move(v);
 }
 
 const StateValue& State::operator[](const Value &val) {
-  auto &[var, val_uvars] = values[values_map.at(&val)];
+  unsigned idx = values_map.at(&val);
+  auto &[var, val_uvars] = values[idx];
   auto &[sval, uvars] = val_uvars;
 
-  auto undef_itr = analysis.non_undef_vals.find(&val);
-  bool is_non_undef = undef_itr != analysis.non_undef_vals.end();
-  bool is_non_poison = analysis.non_poison_vals.count(&val);
+  bool is_non_undef = analysis.non_undef_vals.count(idx);
+  bool is_non_poison = analysis.non_poison_vals.count(idx);
 
   auto simplify = [&](StateValue &sv0, bool use_new_slot) -> StateValue& {
     if (!is_non_undef && !is_non_poison)
       return sv0;
 
-    if (use_new_slot) {
-      if (auto ret = no_more_tmp_slots())
-        return *ret;
-      assert(i_tmp_values < tmp_values.size());
-      tmp_values[i_tmp_values++] = sv0;
-    }
-    assert(i_tmp_values > 0);
-    StateValue &sv_new = tmp_values[i_tmp_values - 1];
+    StateValue &sv_new = use_new_slot ? newTmpValue(StateValue(sv0)) : sv0;
     if (is_non_undef) {
-      sv_new.value = undef_itr->second;
+      sv_new.value = analysis.non_undef_exprs.at(idx);
     }
     if (is_non_poison) {
       const expr &np = sv_new.non_poison;
@@ -384,39 +409,43 @@ const StateValue& State::operator[](const Value &val) {
     return simplify(sval, true);
   }
 
-  auto unused_itr = analysis.unused_vars.find(&val);
-  bool unused = unused_itr != analysis.unused_vars.end();
+  bool unused = analysis.unused_vars.count(idx);
   if (uvars.empty() || unused || disable_undef_rewrite) {
     if (unused)
-      analysis.unused_vars.erase(unused_itr);
+      analysis.unused_vars.erase(idx);
     undef_vars.insert(uvars.begin(), uvars.end());
     return simplify(sval, true);
   }
 
-  vector<pair<expr, expr>> repls;
-  for (auto &u : uvars) {
-    repls.emplace_back(u, expr::mkFreshVar("undef", u));
+  // every use gets fresh undef vars, but the value is only traversed once
+  auto I = undef_substs.find(&val);
+  if (I == undef_substs.end())
+    I = undef_substs.try_emplace(&val, vector<expr>{ sval.value,
+                                                     sval.non_poison },
+                                 vector<expr>(uvars.begin(), uvars.end()))
+          .first;
+  auto &subst = I->second;
+
+  if (subst.isIdentity()) {
+    uvars.clear();
+    return sval;
   }
 
   if (hit_half_memory_limit())
     throw AliveException("Out of memory; skipping function.", false);
 
-  auto sval_new = sval.subst(repls);
-  if (sval_new.eq(sval)) {
-    uvars.clear();
-    return sval;
+  vector<expr> fresh;
+  for (auto &u : uvars) {
+    fresh.emplace_back(expr::mkFreshVar("undef", u));
   }
+  auto sval_new = subst(fresh);
 
-  for (auto &p : repls) {
-    undef_vars.emplace(move(p.second));
+  for (auto &v : fresh) {
+    undef_vars.emplace(move(v));
   }
 
-  if (auto ret = no_more_tmp_slots())
-    return *ret;
-
-  assert(i_tmp_values < tmp_values.size());
-  tmp_values[i_tmp_values++] = move(sval_new);
-  return simplify(tmp_values[i_tmp_values - 1], false);
+  return simplify(newTmpValue({ move(sval_new[0]), move(sval_new[1]) }),
+                  false);
 }
 
 const StateValue& State::getAndAddUndefs(const Value &val) {
@@ -449,20 +478,21 @@ static expr not_poison_except_padding(const Type &ty, const expr &np) {
 const StateValue&
 State::getAndAddPoisonUB(const Value &val, bool undef_ub_too) {
   auto &sv = (*this)[val];
+  unsigned idx = values_map.at(&val);
 
-  bool poison_already_added = !analysis.non_poison_vals.insert(&val).second;
+  bool poison_already_added = !analysis.non_poison_vals.insert(idx);
   if (poison_already_added && !undef_ub_too)
     return sv;
 
   expr v = sv.value;
 
   if (undef_ub_too) {
-    auto I = analysis.non_undef_vals.find(&val);
-    if (I != analysis.non_undef_vals.end()) {
-      v = I->second;
+    if (analysis.non_undef_vals.count(idx)) {
+      v = analysis.non_undef_exprs.at(idx);
     } else {
       v = strip_undef_and_add_ub(val, v);
-      analysis.non_undef_vals.emplace(&val, v);
+      analysis.non_undef_vals.insert(idx);
+      analysis.non_undef_exprs.emplace(idx, v);
     }
   }
 
@@ -476,7 +506,9 @@ State::getAndAddPoisonUB(const Value &val, bool undef_ub_too) {
     while (!todo.empty()) {
       auto v = todo.back();
       todo.pop_back();
-      if (!analysis.non_poison_vals.insert(v).second)
+      auto VI = values_map.find(v);
+      if (VI == values_map.end() ||
+          !analysis.non_poison_vals.insert(VI->second))
         continue;
       if (auto i = dynamic_cast<const Instr*>(v)) {
         if (i->propagatesPoison()) {
@@ -490,12 +522,8 @@ State::getAndAddPoisonUB(const Value &val, bool undef_ub_too) {
     addUB(not_poison_except_padding(val.getType(), sv.non_poison));
   }
 
-  if (auto ret = no_more_tmp_slots())
-    return *ret;
-
-  assert(i_tmp_values < tmp_values.size());
-  return tmp_values[i_tmp_values++] = { move(v),
-           sv.non_poison.isBool() ? true : expr::mkInt(-1, sv.non_poison) };
+  return newTmpValue({ move(v),
+           sv.non_poison.isBool() ? true : expr::mkInt(-1, sv.non_poison) });
 }
 
 const State::ValTy& State::at(const Value &val) const {
@@ -546,6 +574,17 @@ bool State::startBB(const BasicBlock &bb) {
   }
 
   domain.path = path();
+
+  // drop BBs that can't be reached before merging the rest of the state
+  if (domain.path.isFalse())
+    return false;
+  if (config::prune_paths_timeout && !domain.path.isTrue()) {
+    Solver s(true);
+    s.add(domain.path);
+    if (s.checkQuick(config::prune_paths_timeout).isUnsat())
+      return false;
+  }
+
   domain.UB = *UB();
   memory = *in_memory();
   var_args_data = *var_args_in();
@@ -558,7 +597,8 @@ void State::addJump(const BasicBlock &dst0, expr &&cond) {
     return;
 
   auto dst = &dst0;
-  if (seen_bbs.count(dst)) {
+  if (seen_bbs.count(dst) ||
+      (unroll_limit && f.getUnrollIteration(*dst) > unroll_limit)) {
     dst = &f.getSinkBB();
   }
 
@@ -631,6 +671,56 @@ void State::addNoReturn() {
   addUB(expr(false));
 }
 
+// a non-poison bit-vector constant; calls with different constants never
+// match (unlike floats, where distinct constants may be the same NaN)
+static bool is_const_arg(const StateValue &v) {
+  return v.non_poison.isTrue() && v.value.isBV() && v.value.isConst();
+}
+
+void State::FnCallIndex::add(FnCalls::iterator call) {
+  unsigned idx = calls.size();
+  calls.emplace_back(call);
+
+  auto &in = call->first;
+  by_effect[{in.readsmem, in.argmemonly}].emplace_back(idx);
+  for (unsigned i = 0, e = in.args_nonptr.size(); i != e; ++i) {
+    auto &arg = in.args_nonptr[i];
+    if (is_const_arg(arg))
+      by_const[{in.readsmem, in.argmemonly, i, arg.value}].emplace_back(idx);
+    else
+      non_const[{in.readsmem, in.argmemonly, i}].emplace_back(idx);
+  }
+}
+
+vector<unsigned>
+State::FnCallIndex::candidates(const vector<StateValue> &args, bool readsmem,
+                               bool argmemonly) const {
+  auto I = by_effect.find({readsmem, argmemonly});
+  if (I == by_effect.end())
+    return {};
+
+  // pick the constant argument that rules out the most calls
+  vector<unsigned> ret = I->second;
+  for (unsigned i = 0, e = args.size(); i != e; ++i) {
+    if (!is_const_arg(args[i]))
+      continue;
+
+    static const vector<unsigned> empty;
+    auto C = by_const.find({readsmem, argmemonly, i, args[i].value});
+    auto N = non_const.find({readsmem, argmemonly, i});
+    auto &same = C != by_const.end() ? C->second : empty;
+    auto &any = N != non_const.end() ? N->second : empty;
+    if (same.size() + any.size() >= ret.size())
+      continue;
+
+    vector<unsigned> merged;
+    merge(same.begin(), same.end(), any.begin(), any.end(),
+          back_inserter(merged));
+    ret = move(merged);
+  }
+  return ret;
+}
+
 expr State::FnCallInput::operator==(const FnCallInput &rhs) const {
   if (readsmem != rhs.readsmem ||
       argmemonly != rhs.argmemonly ||
@@ -768,6 +858,7 @@ State::addFnCall(const string &name, vector<StateValue> &&inputs,
             reads_memory, argmemonly });
     auto &I = call_data_pair.first;
     bool inserted = call_data_pair.second;
+    auto &index = fn_call_index[name];
 
     if (inserted) {
       auto mk_val = [&](const Type &t, const string &name) {
@@ -795,13 +886,14 @@ State::addFnCall(const string &name, vector<StateValue> &&inputs,
               : Memory::CallState() };
 
       // add equality constraints between source's function calls
-      for (auto II = calls_fn.begin(), E = calls_fn.end(); II != E; ++II) {
-        if (II == I)
-          continue;
+      for (unsigned idx : index.candidates(I->first.args_nonptr, reads_memory,
+                                           argmemonly)) {
+        auto II = index.calls[idx];
         auto in_eq = I->first == II->first;
         if (!in_eq.isFalse())
           fn_call_pre &= in_eq.implies(I->second == II->second);
       }
+      index.add(I);
     }
 
     addUB(I->second.ub);
@@ -813,7 +905,9 @@ State::addFnCall(const string &name, vector<StateValue> &&inputs,
     // target: this fn call must match one from the source, otherwise it's UB
     ChoiceExpr<FnCallOutput> data;
 
-    for (auto &[in, out] : fn_call_data[name]) {
+    auto &index = fn_call_index[name];
+    for (unsigned idx : index.candidates(inputs, reads_memory, argmemonly)) {
+      auto &[in, out] = *index.calls[idx];
       auto refined = in.refinedBy(*this, inputs, ptr_inputs,
                                   analysis.ranges_fn_calls, memory,
                                   reads_memory, argmemonly);
@@ -902,6 +996,18 @@ expr State::sinkDomain() const {
   return ret();
 }
 
+expr State::jumpDomain(const BasicBlock &src, const BasicBlock &dst) const {
+  auto I = predecessor_data.find(&dst);
+  if (I == predecessor_data.end())
+    return false;
+
+  auto II = I->second.find(&src);
+  if (II == I->second.end())
+    return false;
+
+  return II->second.path() && *II->second.UB();
+}
+
 void State::addGlobalVarBid(const string &glbvar, unsigned bid) {
   ENSURE(glbvar_bids.emplace(glbvar, make_pair(bid, true)).second);
 }
@@ -931,11 +1037,18 @@ void State::syncSEdataWithSrc(const State &src) {
     itm.second.second = false;
 
   fn_call_data = src.fn_call_data;
+  fn_call_index.clear();
+  for (auto &[fn, calls] : fn_call_data) {
+    auto &index = fn_call_index[fn];
+    for (auto I = calls.begin(), E = calls.end(); I != E; ++I)
+      index.add(I);
+  }
   memory.syncWithSrc(src.returnMemory());
 }
 
 void State::mkAxioms(State &tgt) {
   assert(isSource() && !tgt.isSource());
+  TraceSpan span("mkAxioms");
   returnMemory().mkAxioms(tgt.returnMemory());
 }
 
@@ -4,10 +4,12 @@
 // Distributed under the MIT license that can be found in the LICENSE file.
 
 #include "ir/memory.h"
+#include "ir/points_to.h"
 #include "ir/state_value.h"
 #include "smt/expr.h"
 #include "smt/exprs.h"
-#include <array>
+#include "util/bitset.h"
+#include <deque>
 #include <map>
 #include <ostream>
 #include <set>
@@ -39,11 +41,14 @@ private:
   };
 
   struct ValueAnalysis {
-    std::set<const Value *> non_poison_vals; // vars that are not poison
+    // Vars are identified by their index in values
+    util::BitSet non_poison_vals; // vars that are not poison
     // vars that are not undef (partially undefs are not allowed too)
-    std::map<const Value *, smt::expr> non_undef_vals;
+    util::BitSet non_undef_vals;
+    // var -> value without undef, for each var in non_undef_vals
+    std::unordered_map<unsigned, smt::expr> non_undef_exprs;
     // vars that have never been used
-    std::set<const Value *> unused_vars;
+    util::BitSet unused_vars;
 
     struct FnCallRanges
       : public std::map<std::string, std::pair<unsigned, unsigned>> {
@@ -101,6 +106,8 @@ private:
   // var -> ((value, not_poison), undef_vars)
   std::unordered_map<const Value*, unsigned> values_map;
   std::vector<std::pair<const Value*, ValTy>> values;
+  // precomputed substitutions of the undef vars of each value
+  std::unordered_map<const Value*, smt::ExprSubst> undef_substs;
 
   // dst BB -> src BB -> BasicBlockInfo
   std::unordered_map<const BasicBlock*,
@@ -108,6 +115,15 @@ private:
     predecessor_data;
   std::unordered_set<const BasicBlock*> seen_bbs;
 
+  // values encoded as unconstrained variables instead of being executed
+  std::unordered_set<const Value*> abstract_values;
+
+  // jumps to loop iterations past this one go to the sink (0 = no limit)
+  unsigned unroll_limit = 0;
+
+  // restricts the blocks that pointers may point to
+  PointsTo points_to;
+
   // Global variables' memory block ids & Memory::alloc has been called?
   std::unordered_map<std::string, std::pair<unsigned, bool>> glbvar_bids;
 
@@ -117,10 +133,12 @@ private:
   Memory memory;
   std::set<smt::expr> undef_vars;
   ValueAnalysis analysis;
-  std::array<StateValue, 64> tmp_values;
+  // values created while rewriting the operands of the current instruction;
+  // a deque so that references stay valid as it grows
+  std::deque<StateValue> tmp_values;
   unsigned i_tmp_values = 0; // next available position in tmp_values
 
-  StateValue* no_more_tmp_slots();
+  StateValue& newTmpValue(StateValue &&v);
 
   // return_domain: a boolean expression describing return condition
   smt::OrExpr return_domain;
@@ -156,7 +174,27 @@ private:
     smt::expr operator==(const FnCallOutput &rhs) const;
     auto operator<=>(const FnCallOutput &rhs) const = default;
   };
-  std::map<std::string, std::map<FnCallInput, FnCallOutput>> fn_call_data;
+  using FnCalls = std::map<FnCallInput, FnCallOutput>;
+  std::map<std::string, FnCalls> fn_call_data;
+
+  // Calls to a function indexed by their memory effects and constant
+  // arguments, so that only calls that may have the same inputs are compared
+  struct FnCallIndex {
+    std::vector<FnCalls::iterator> calls;
+    // (reads memory, argmemonly) -> calls
+    std::map<std::pair<bool, bool>, std::vector<unsigned>> by_effect;
+    // (reads memory, argmemonly, arg, value) -> calls with that constant arg
+    std::map<std::tuple<bool, bool, unsigned, smt::expr>,
+             std::vector<unsigned>> by_const;
+    // (reads memory, argmemonly, arg) -> calls where that arg isn't constant
+    std::map<std::tuple<bool, bool, unsigned>, std::vector<unsigned>> non_const;
+
+    void add(FnCalls::iterator call);
+    // calls in order of insertion
+    std::vector<unsigned> candidates(const std::vector<StateValue> &args,
+                                     bool readsmem, bool argmemonly) const;
+  };
+  std::map<std::string, FnCallIndex> fn_call_index;
   smt::expr fn_call_pre = true;
   std::set<smt::expr> fn_call_qvars;
 
@@ -219,6 +257,15 @@ public:
   bool isInitializationPhase() const { return is_initialization_phase; }
   void finishInitializer();
 
+  // The given values get a fresh variable named after them, so values with
+  // the same name in src and tgt are equal.
+  void setAbstractValues(std::unordered_set<const Value*> vals) {
+    abstract_values = std::move(vals);
+  }
+
+  void setUnrollLimit(unsigned limit) { unroll_limit = limit; }
+  void setPointsTo(PointsTo &&pts) { points_to = std::move(pts); }
+
   auto& getFn() const { return f; }
   auto& getMemory() const { return memory; }
   auto& getMemory() { return memory; }
@@ -232,6 +279,8 @@ public:
   auto& functionDomain() const { return function_domain; }
   auto& returnDomain() const { return return_domain; }
   smt::expr sinkDomain() const;
+  // path and UB condition of the jump from src to dst (which may be the sink)
+  smt::expr jumpDomain(const BasicBlock &src, const BasicBlock &dst) const;
   Memory returnMemory() const { return *return_memory(); }
 
   std::pair<StateValue, const std::set<smt::expr>&> returnVal() const {
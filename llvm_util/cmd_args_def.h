@@ -8,14 +8,27 @@ config::tgt_unroll_cnt = opt_tgt_unrolling_factor;
 config::src_unroll_cnt = opt_unrolling_factor;
 config::src_unroll_cnt = opt_unrolling_factor;
 #endif
+config::unroll_deepen = opt_unroll_deepen;
+config::loop_induction = opt_loop_induction;
+config::prune_paths_timeout = opt_prune_paths;
+config::points_to = opt_points_to;
+config::memop_unroll_bytes = opt_memop_unroll;
 config::disable_undef_input = opt_disable_undef;
 config::disable_poison_input = opt_disable_poison;
 config::symexec_print_each_value = opt_se_verbose;
 smt::set_query_timeout(to_string(opt_smt_to));
 smt::set_memory_limit((uint64_t)opt_smt_max_mem * 1024 * 1024);
 smt::set_random_seed(to_string(opt_smt_random_seed));
+smt::solver_portfolio(opt_smt_portfolio);
 config::skip_smt = opt_smt_skip;
 config::smt_benchmark_dir = opt_smt_bench_dir;
+config::smt_cache_dir = opt_smt_cache_dir;
+config::incremental_refinement = opt_smt_incremental;
+config::split_memory = opt_smt_split_memory;
+config::concrete_tests = opt_concrete_tests;
+config::adaptive_widths = opt_adaptive_widths;
+config::lockstep = opt_lockstep;
+config::slice = opt_slice;
 smt::solver_print_queries(opt_smt_verbose);
 smt::solver_tactic_verbose(opt_tactic_verbose);
 config::debug = opt_debug;
@@ -23,6 +36,9 @@ config::max_offset_bits = opt_max_offset_in_bits;
 
 func_names.insert(opt_funcs.begin(), opt_funcs.end());
 
+if (!opt_trace_file.empty())
+  util::trace::start(opt_trace_file);
+
 if (!report_dir_created && !opt_report_dir.empty()) {
   try {
     fs::create_directories(opt_report_dir.getValue());
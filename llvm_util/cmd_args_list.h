@@ -3,6 +3,7 @@
 
 #include "util/config.h"
 #include "util/random.h"
+#include "util/trace.h"
 #include "llvm/Support/CommandLine.h"
 #include <filesystem>
 
@@ -32,6 +33,33 @@ llvm::cl::opt<unsigned> opt_unrolling_factor(LLVM_ARGS_PREFIX "unroll",
   llvm::cl::init(0), llvm::cl::cat(alive_cmdargs));
 #endif
 
+llvm::cl::opt<bool> opt_unroll_deepen(LLVM_ARGS_PREFIX "unroll-deepen",
+  llvm::cl::desc("Try smaller unrolling factors first and increase them only "
+                 "if a loop runs for longer (default=false)"),
+  llvm::cl::init(false), llvm::cl::cat(alive_cmdargs));
+
+llvm::cl::opt<bool> opt_loop_induction(LLVM_ARGS_PREFIX "loop-induction",
+  llvm::cl::desc("Try to prove simple loops correct for any number of "
+                 "iterations by induction before unrolling (default=false)"),
+  llvm::cl::init(false), llvm::cl::cat(alive_cmdargs));
+
+llvm::cl::opt<unsigned> opt_prune_paths(LLVM_ARGS_PREFIX "prune-paths",
+  llvm::cl::desc("Skip BBs whose path condition is shown unsatisfiable within "
+                 "this many ms (default=0, disabled)"),
+  llvm::cl::init(0), llvm::cl::value_desc("ms"),
+  llvm::cl::cat(alive_cmdargs));
+
+llvm::cl::opt<bool> opt_points_to(LLVM_ARGS_PREFIX "points-to",
+  llvm::cl::desc("Run a points-to analysis to narrow the blocks that loaded "
+                 "pointers may alias (default=false)"),
+  llvm::cl::init(false), llvm::cl::cat(alive_cmdargs));
+
+llvm::cl::opt<unsigned> opt_memop_unroll(LLVM_ARGS_PREFIX "memop-unroll",
+  llvm::cl::desc("Lower memset/memcpy with a constant size up to this many "
+                 "bytes and constant offsets to stores (default=64)"),
+  llvm::cl::init(64), llvm::cl::value_desc("bytes"),
+  llvm::cl::cat(alive_cmdargs));
+
 llvm::cl::opt<bool> opt_disable_undef(LLVM_ARGS_PREFIX "disable-undef-input",
   llvm::cl::desc("Assume inputs are not undef (default=false)"),
   llvm::cl::init(false), llvm::cl::cat(alive_cmdargs));
@@ -65,6 +93,32 @@ llvm::cl::opt<unsigned> opt_smt_random_seed(LLVM_ARGS_PREFIX "smt-random-seed",
   llvm::cl::desc("Random seed for the SMT solver (default=0)"),
   llvm::cl::init(0), llvm::cl::cat(alive_cmdargs));
 
+llvm::cl::opt<unsigned> opt_smt_portfolio(LLVM_ARGS_PREFIX "smt-portfolio",
+  llvm::cl::desc("Number of solver configurations to race in parallel for "
+                 "each SMT query (default=1)"),
+  llvm::cl::init(1), llvm::cl::cat(alive_cmdargs));
+
+llvm::cl::opt<unsigned> opt_concrete_tests(LLVM_ARGS_PREFIX "concrete-tests",
+  llvm::cl::desc("Number of concrete inputs to try before calling the SMT "
+                 "solver (default=0)"),
+  llvm::cl::init(0), llvm::cl::cat(alive_cmdargs));
+
+llvm::cl::opt<bool> opt_adaptive_widths(LLVM_ARGS_PREFIX "adaptive-widths",
+  llvm::cl::desc("Look for counterexamples with narrow pointer offsets "
+                 "first; proofs always use the full width (default=false)"),
+  llvm::cl::init(false), llvm::cl::cat(alive_cmdargs));
+
+llvm::cl::opt<bool> opt_lockstep(LLVM_ARGS_PREFIX "lockstep",
+  llvm::cl::desc("Align identical source and target instructions and try to "
+                 "prove refinement with the same undef values first "
+                 "(default=false)"),
+  llvm::cl::init(false), llvm::cl::cat(alive_cmdargs));
+
+llvm::cl::opt<bool> opt_slice(LLVM_ARGS_PREFIX "slice",
+  llvm::cl::desc("Try first with the instructions that are the same in source "
+                 "and target abstracted away (default=false)"),
+  llvm::cl::init(false), llvm::cl::cat(alive_cmdargs));
+
 llvm::cl::opt<bool> opt_smt_log(LLVM_ARGS_PREFIX "smt-log",
   llvm::cl::desc("Log interactions with the SMT solver"),
   llvm::cl::init(false), llvm::cl::cat(alive_cmdargs));
@@ -77,6 +131,20 @@ llvm::cl::opt<string> opt_smt_bench_dir(LLVM_ARGS_PREFIX "smt-bench",
   llvm::cl::desc("Dump smtlib benchmarks"),
   llvm::cl::value_desc("directory"), llvm::cl::cat(alive_cmdargs));
 
+llvm::cl::opt<string> opt_smt_cache_dir(LLVM_ARGS_PREFIX "smt-cache",
+  llvm::cl::desc("Cache SMT query results across runs"),
+  llvm::cl::value_desc("directory"), llvm::cl::cat(alive_cmdargs));
+
+llvm::cl::opt<bool> opt_smt_incremental(LLVM_ARGS_PREFIX "smt-incremental",
+  llvm::cl::desc("Run the refinement checks of a function in a single "
+                 "incremental SMT solver (default=false)"),
+  llvm::cl::init(false), llvm::cl::cat(alive_cmdargs));
+
+llvm::cl::opt<unsigned> opt_smt_split_memory(LLVM_ARGS_PREFIX "smt-split-memory",
+  llvm::cl::desc("Check the memory refinement of each block separately, "
+                 "running up to this many queries in parallel (default=0)"),
+  llvm::cl::init(0), llvm::cl::cat(alive_cmdargs));
+
 llvm::cl::opt<bool> opt_smt_verbose(LLVM_ARGS_PREFIX "smt-verbose",
   llvm::cl::desc("SMT verbose mode"),
   llvm::cl::init(false), llvm::cl::cat(alive_cmdargs));
@@ -117,6 +185,11 @@ llvm::cl::opt<bool> opt_elapsed_time(LLVM_ARGS_PREFIX "time-verify",
   llvm::cl::desc("Print time taken to verify each transformation"),
   llvm::cl::init(false), llvm::cl::cat(alive_cmdargs));
 
+llvm::cl::opt<string> opt_trace_file(LLVM_ARGS_PREFIX "trace",
+  llvm::cl::desc("Write a trace of the verification phases in Chrome trace "
+                 "format (for chrome://tracing or ui.perfetto.dev)"),
+  llvm::cl::value_desc("filename"), llvm::cl::cat(alive_cmdargs));
+
 llvm::cl::opt<string> opt_outputfile(LLVM_ARGS_PREFIX "o",
   llvm::cl::desc("Specify output filename"), llvm::cl::cat(alive_cmdargs));
 
@@ -5,6 +5,7 @@
 #include "llvm_util/known_fns.h"
 #include "llvm_util/utils.h"
 #include "util/sort.h"
+#include "util/trace.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Analysis/MemoryBuiltins.h"
 #include "llvm/Analysis/ValueTracking.h"
@@ -1411,6 +1412,7 @@ initializer::initializer(ostream &os, const llvm::DataLayout &DL) {
 optional<IR::Function> llvm2alive(llvm::Function &F,
                                   const llvm::TargetLibraryInfo &TLI,
                                   const vector<string_view> &gvnamesInSrc) {
+  util::TraceSpan span("llvm2alive", F.getName().str());
   return llvm2alive_(F, TLI, gvnamesInSrc).run();
 }
 
@@ -25,7 +25,7 @@ static void z3_error_handler(Z3_context ctx, Z3_error_code err) {
 
 namespace smt {
 
-context ctx;
+thread_local context ctx;
 
 void context::initialize() {
   Z3_global_param_set("model.partial", "true");
@@ -20,6 +20,8 @@ public:
   void destroy();
 };
 
-extern context ctx;
+// Each thread has its own Z3 context. Z3 objects must not be shared across
+// threads.
+extern thread_local context ctx;
 
 }
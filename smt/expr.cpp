@@ -6,12 +6,14 @@
 #include "smt/ctx.h"
 #include "util/compiler.h"
 #include <algorithm>
+#include <atomic>
 #include <bit>
 #include <cassert>
 #include <climits>
 #include <limits>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <z3.h>
 
 #define DEBUG_Z3_RC 0
@@ -1917,6 +1919,142 @@ expr expr::subst(const vector<expr> &repls) const {
   return Z3_substitute_vars(ctx(), ast(), repls.size(), vars.get());
 }
 
+static atomic<uint64_t> num_substs = 0;
+static atomic<uint64_t> num_rebuilt_terms = 0;
+
+ExprSubst::ExprSubst(vector<expr> roots0, vector<expr> vars0)
+  : roots(std::move(roots0)), vars(std::move(vars0)) {
+  auto valid = [](const vector<expr> &v) {
+    return all_of(v.begin(), v.end(), [](auto &e) { return e.isValid(); });
+  };
+  if (!valid(roots) || !valid(vars)) {
+    fallback = true;
+    return;
+  }
+
+  // term index of each visited AST, or -1 if it doesn't depend on the vars
+  unordered_map<Z3_ast, int> idx;
+  for (unsigned i = 0, e = vars.size(); i != e; ++i) {
+    if (idx.try_emplace(vars[i](), (int)terms.size()).second)
+      terms.push_back({ vars[i], {}, i });
+  }
+
+  // post-order traversal; the flag is set once the arguments were queued
+  vector<pair<Z3_ast, bool>> todo;
+  for (auto &r : roots) {
+    todo.emplace_back(r(), false);
+  }
+
+  while (!todo.empty()) {
+    auto [ast, expanded] = todo.back();
+    if (!expanded && idx.count(ast)) {
+      todo.pop_back();
+      continue;
+    }
+
+    auto kind = Z3_get_ast_kind(ctx(), ast);
+    if (kind == Z3_QUANTIFIER_AST) {
+      // Z3_update_term can't rebuild quantifiers; use Z3_substitute instead
+      fallback = true;
+      return;
+    }
+    if (kind != Z3_APP_AST || Z3_is_numeral_ast(ctx(), ast)) {
+      idx.emplace(ast, -1);
+      todo.pop_back();
+      continue;
+    }
+
+    auto app = Z3_to_app(ctx(), ast);
+    auto num_args = Z3_get_app_num_args(ctx(), app);
+    if (!expanded) {
+      todo.back().second = true;
+      for (unsigned i = 0; i < num_args; ++i) {
+        auto arg = Z3_get_app_arg(ctx(), app, i);
+        if (!idx.count(arg))
+          todo.emplace_back(arg, false);
+      }
+      continue;
+    }
+    todo.pop_back();
+
+    Term t{ expr(ast), {} };
+    for (unsigned i = 0; i < num_args; ++i) {
+      if (auto I = idx.at(Z3_get_app_arg(ctx(), app, i)); I >= 0)
+        t.args.emplace_back(i, (unsigned)I);
+    }
+    int id = -1;
+    if (!t.args.empty()) {
+      id = terms.size();
+      terms.emplace_back(std::move(t));
+    }
+    idx.emplace(ast, id);
+  }
+
+  for (auto &r : roots) {
+    root_terms.emplace_back(idx.at(r()));
+  }
+}
+
+bool ExprSubst::isIdentity() const {
+  return !fallback &&
+         all_of(root_terms.begin(), root_terms.end(),
+                [](int t) { return t < 0; });
+}
+
+vector<expr> ExprSubst::operator()(const vector<expr> &vals) const {
+  assert(vals.size() == vars.size());
+  ++num_substs;
+
+  if (fallback) {
+    vector<pair<expr, expr>> repls;
+    for (unsigned i = 0, e = vars.size(); i != e; ++i) {
+      repls.emplace_back(vars[i], vals[i]);
+    }
+    vector<expr> ret;
+    for (auto &r : roots) {
+      ret.emplace_back(r.subst(repls));
+    }
+    return ret;
+  }
+
+  if (!all_of(vals.begin(), vals.end(), [](auto &e) { return e.isValid(); }))
+    return vector<expr>(roots.size());
+
+  vector<expr> built;
+  built.reserve(terms.size());
+  vector<Z3_ast> args;
+
+  for (auto &t : terms) {
+    if (t.args.empty()) {
+      built.emplace_back(vals[t.var]);
+      continue;
+    }
+    auto app = Z3_to_app(ctx(), t.e());
+    auto num_args = Z3_get_app_num_args(ctx(), app);
+    args.resize(num_args);
+    for (unsigned i = 0; i < num_args; ++i) {
+      args[i] = Z3_get_app_arg(ctx(), app, i);
+    }
+    for (auto &[i, term] : t.args) {
+      args[i] = built[term]();
+    }
+    built.push_back(
+      expr(Z3_update_term(ctx(), t.e(), num_args, args.data())));
+    ++num_rebuilt_terms;
+  }
+
+  vector<expr> ret;
+  for (unsigned i = 0, e = roots.size(); i != e; ++i) {
+    ret.emplace_back(root_terms[i] < 0 ? roots[i] : built[root_terms[i]]);
+  }
+  return ret;
+}
+
+void ExprSubst::printStats(ostream &os) {
+  os << "Num substs:  " << num_substs << " (" << num_rebuilt_terms
+     << " terms rebuilt)\n";
+}
+
 set<expr> expr::vars() const {
   return vars({ this });
 }
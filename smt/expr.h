@@ -358,6 +358,38 @@ public:
 
   friend class Solver;
   friend class Model;
+  friend class ExprSubst;
+};
+
+
+// Replaces the same variables in a set of expressions over and over, with
+// different values each time. The expressions are traversed once; each
+// substitution only rebuilds the terms that depend on the variables and
+// shares the rest with the original expressions.
+class ExprSubst {
+  struct Term {
+    expr e;
+    // (argument index, term index) of the arguments that need rebuilding;
+    // empty if the term is a variable
+    std::vector<std::pair<unsigned, unsigned>> args;
+    unsigned var = 0;
+  };
+  std::vector<expr> roots;
+  std::vector<expr> vars;
+  std::vector<Term> terms; // arguments come before their users
+  std::vector<int> root_terms; // -1 if the root doesn't depend on the vars
+  bool fallback = false; // vars appear below a quantifier
+
+public:
+  ExprSubst(std::vector<expr> roots, std::vector<expr> vars);
+
+  // true if the roots don't depend on the variables
+  bool isIdentity() const;
+
+  // vals[i] replaces vars[i]; returns the new roots
+  std::vector<expr> operator()(const std::vector<expr> &vals) const;
+
+  static void printStats(std::ostream &os);
 };
 
 
@@ -182,28 +182,35 @@ DisjointExpr<expr>::DisjointExpr(const expr &e, unsigned depth_limit) {
 
 
 void FunctionExpr::add(const expr &key, expr &&val) {
-  ENSURE(fn.emplace(key, move(val)).second);
+  ENSURE(fn.write().emplace(key, move(val)).second);
 }
 
 void FunctionExpr::add(const FunctionExpr &other) {
-  fn.insert(other.fn.begin(), other.fn.end());
+  if (fn.shares(other.fn))
+    return;
+  if (fn->empty()) {
+    fn = other.fn;
+    return;
+  }
+  fn.write().insert(other.fn->begin(), other.fn->end());
 }
 
 void FunctionExpr::del(const expr &key) {
-  fn.erase(key);
+  if (fn->count(key))
+    fn.write().erase(key);
 }
 
 optional<expr> FunctionExpr::operator()(const expr &key) const {
   DisjointExpr disj(default_val);
-  for (auto &[k, v] : fn) {
+  for (auto &[k, v] : *fn) {
     disj.add(v, k == key);
   }
   return disj();
 }
 
 const expr* FunctionExpr::lookup(const expr &key) const {
-  auto I = fn.find(key);
-  return I != fn.end() ? &I->second : nullptr;
+  auto I = fn->find(key);
+  return I != fn->end() ? &I->second : nullptr;
 }
 
 FunctionExpr FunctionExpr::simplify() const {
@@ -211,7 +218,7 @@ FunctionExpr FunctionExpr::simplify() const {
   if (default_val)
     newfn.default_val = default_val->simplify();
 
-  for (auto &[k, v] : fn) {
+  for (auto &[k, v] : *fn) {
     newfn.add(k.simplify(), v.simplify());
   }
   return newfn;
@@ -5,6 +5,7 @@
 
 #include "smt/expr.h"
 #include "util/compiler.h"
+#include "util/cow.h"
 #include <cassert>
 #include <compare>
 #include <map>
@@ -163,7 +164,7 @@ public:
 
 
 class FunctionExpr {
-  std::map<expr, expr> fn; // key -> val
+  util::cow<std::map<expr, expr>> fn; // key -> val
   std::optional<expr> default_val;
 
 public:
@@ -178,9 +179,9 @@ public:
 
   FunctionExpr simplify() const;
 
-  auto begin() const { return fn.begin(); }
-  auto end() const { return fn.end(); }
-  bool empty() const { return fn.empty() && !default_val; }
+  auto begin() const { return fn->begin(); }
+  auto end() const { return fn->end(); }
+  bool empty() const { return fn->empty() && !default_val; }
 
   std::weak_ordering operator<=>(const FunctionExpr &rhs) const;
 
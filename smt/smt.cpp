@@ -6,6 +6,7 @@
 #include "smt/solver.h"
 #include "util/version.h"
 #include <cstdint>
+#include <mutex>
 #include <string>
 #include <z3.h>
 
@@ -14,19 +15,30 @@ using namespace std;
 
 namespace smt {
 
+// Z3's memory reset/finalization is process-wide, so it can only be done
+// when a single thread is using Z3.
+static mutex init_mutex;
+static unsigned num_initializers = 0;
+
 smt_initializer::smt_initializer() {
+  lock_guard<mutex> lock(init_mutex);
+  ++num_initializers;
   init();
 }
 
 void smt_initializer::reset() {
+  lock_guard<mutex> lock(init_mutex);
   destroy();
-  Z3_reset_memory();
+  if (num_initializers == 1)
+    Z3_reset_memory();
   init();
 }
 
 smt_initializer::~smt_initializer() {
+  lock_guard<mutex> lock(init_mutex);
   destroy();
-  Z3_finalize_memory();
+  if (--num_initializers == 0)
+    Z3_finalize_memory();
 }
 
 void smt_initializer::init() {
@@ -7,6 +7,8 @@
 
 namespace smt {
 
+// Sets up the SMT context of the calling thread. Each thread using the SMT
+// layer must have its own initializer.
 struct smt_initializer {
   smt_initializer();
   ~smt_initializer();
@@ -3,34 +3,51 @@
 
 #include "smt/solver.h"
 #include "smt/ctx.h"
+#include "smt/smt.h"
 #include "util/compiler.h"
 #include "util/config.h"
 #include "util/file.h"
+#include "util/trace.h"
+#include <atomic>
 #include <cassert>
+#include <cctype>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <map>
 #include <optional>
+#include <sstream>
 #include <string_view>
 #include <utility>
 #include <vector>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #include <z3.h>
 
 using namespace smt;
 using namespace util;
 using namespace std;
 using util::config::dbg;
+namespace fs = std::filesystem;
 
 static bool tactic_verbose = false;
 
-static unsigned num_queries = 0;
-static unsigned num_skips = 0;
-static unsigned num_invalid = 0;
-static unsigned num_trivial = 0;
-static unsigned num_sats = 0;
-static unsigned num_unsats = 0;
-static unsigned num_timeout = 0;
-static unsigned num_errors = 0;
+// statistics are shared by all threads
+static atomic<unsigned> num_queries = 0;
+static atomic<unsigned> num_skips = 0;
+static atomic<unsigned> num_invalid = 0;
+static atomic<unsigned> num_trivial = 0;
+static atomic<unsigned> num_sats = 0;
+static atomic<unsigned> num_unsats = 0;
+static atomic<unsigned> num_timeout = 0;
+static atomic<unsigned> num_errors = 0;
+static atomic<unsigned> num_cache_hits = 0;
 
 namespace {
 class Tactic {
@@ -151,7 +168,132 @@ public:
 };
 }
 
-static optional<MultiTactic> tactic;
+static const initializer_list<const char*> default_tactics = {
+  "simplify",
+  "propagate-values",
+  "simplify",
+  "elim-uncnstr",
+  "qe-light",
+  "simplify",
+  "elim-uncnstr",
+  "reduce-args",
+  "qe-light",
+  "simplify",
+  "smt"
+};
+
+// tactics belong to the thread's Z3 context
+static thread_local optional<MultiTactic> tactic;
+static thread_local string tactic_desc; // part of the query cache key
+
+static unsigned portfolio_size = 1;
+
+
+namespace {
+// Content-addressed store of previous query results, keyed by the hash of
+// the smtlib query plus the solver configuration.
+// Each entry holds "<result> <key length>" followed by the full key, which is
+// compared on lookup to rule out hash collisions.
+// Timeouts are not stored since they depend on the load of the machine.
+class QueryCache {
+  string key;
+  fs::path path;
+
+  // Z3 names let-bound terms after their internal AST ids, which depend on
+  // everything created before. Renumber them in order of appearance so that
+  // identical queries get identical keys.
+  static string canonicalize(string_view str) {
+    string out;
+    out.reserve(str.size());
+    map<string_view, unsigned> names;
+    bool quoted = false;
+
+    for (size_t i = 0, e = str.size(); i != e; ++i) {
+      char c = str[i];
+      if (c == '|')
+        quoted = !quoted;
+
+      if (!quoted && (c == '?' || c == '$') && i+1 != e && str[i+1] == 'x' &&
+          (i == 0 || str[i-1] == '(' || str[i-1] == ' ' || str[i-1] == '\n')) {
+        size_t end = i + 2;
+        while (end != e && isdigit((unsigned char)str[end]))
+          ++end;
+        if (end != i + 2) {
+          auto name = str.substr(i, end - i);
+          out += c;
+          out += 'x';
+          out += to_string(names.try_emplace(name, names.size()).first->second);
+          i = end - 1;
+          continue;
+        }
+      }
+      out += c;
+    }
+    return out;
+  }
+
+public:
+  QueryCache(string_view q) {
+    key = get_query_timeout();
+    key += ' ';
+    key += get_random_seed();
+    key += ' ';
+    key += tactic_desc;
+    key += ' ';
+    key += to_string(portfolio_size);
+    key += '\n';
+    key += canonicalize(q);
+
+    uint64_t h = fnv1a(key);
+    ostringstream name;
+    name << hex << setw(16) << setfill('0') << h << ".res";
+    path = fs::path(config::smt_cache_dir) / name.str();
+  }
+
+  optional<Result::answer> lookup() const {
+    ifstream file(path);
+    string res;
+    size_t len;
+    if (!(file >> res >> len) || len != key.size() || file.get() != '\n')
+      return {};
+
+    string stored(len, '\0');
+    if (!file.read(stored.data(), len) || stored != key)
+      return {};
+
+    if (res == "unsat")
+      return Result::UNSAT;
+    if (res == "sat")
+      return Result::SAT;
+    return {};
+  }
+
+  void store(Result::answer a) const {
+    const char *res;
+    switch (a) {
+    case Result::UNSAT:   res = "unsat"; break;
+    case Result::SAT:     res = "sat"; break;
+    default:              return;
+    }
+
+    // write to a temporary file first so concurrent readers never observe
+    // a partial entry
+    error_code ec;
+    fs::create_directories(config::smt_cache_dir, ec);
+    auto tmp = get_random_filename(config::smt_cache_dir, "tmp");
+    {
+      ofstream file(tmp);
+      if (!file.is_open())
+        return;
+      file << res << ' ' << key.size() << '\n' << key;
+    }
+    fs::rename(tmp, path, ec);
+    if (ec)
+      fs::remove(tmp, ec);
+  }
+
+};
+}
 
 
 namespace smt {
@@ -221,6 +363,10 @@ void solver_tactic_verbose(bool yes) {
   tactic_verbose = yes;
 }
 
+void solver_portfolio(unsigned size) {
+  portfolio_size = max(size, 1u);
+}
+
 Solver::Solver(bool simple) {
   s = simple ? Z3_mk_simple_solver(ctx())
              : Z3_mk_solver_from_tactic(ctx(), tactic->t);
@@ -295,20 +441,26 @@ Result Solver::check() const {
     return Result::UNSAT;
   }
 
-  if (!config::smt_benchmark_dir.empty()) {
+  optional<QueryCache> cache;
+  if (!config::smt_benchmark_dir.empty() || !config::smt_cache_dir.empty()) {
     const char *banner =
     R"(Alive2 compiler optimization refinement query
 ; More info in "Alive2: Bounded Translation Validation for LLVM", PLDI'21.)";
     expr fml = assertions();
     if (!fml.isTrue()) {
-      auto str = Z3_benchmark_to_smtlib_string(ctx(), banner, nullptr, nullptr,
-                                               nullptr, 0, nullptr, fml());
-      ofstream file(get_random_filename(config::smt_benchmark_dir, "smt2"));
-      if (!file.is_open()) {
-        dbg() << "Alive2: Couldn't open smtlib benchmark file!" << endl;
-        exit(1);
+      string str = Z3_benchmark_to_smtlib_string(ctx(), banner, nullptr,
+                                                 nullptr, nullptr, 0, nullptr,
+                                                 fml());
+      if (!config::smt_benchmark_dir.empty()) {
+        ofstream file(get_random_filename(config::smt_benchmark_dir, "smt2"));
+        if (!file.is_open()) {
+          dbg() << "Alive2: Couldn't open smtlib benchmark file!" << endl;
+          exit(1);
+        }
+        file << str;
       }
-      file << str;
+      if (!config::smt_cache_dir.empty())
+        cache.emplace(str);
     }
   }
 
@@ -321,22 +473,66 @@ Result Solver::check() const {
   if (print_queries)
     dbg() << "\nSMT query:\n" << Z3_solver_to_string(ctx(), s) << endl;
 
-  tactic->check();
+  // SAT answers are not served from the cache as we need the model
+  if (cache) {
+    auto cached = cache->lookup();
+    if (cached == Result::UNSAT) {
+      ++num_cache_hits;
+      ++num_unsats;
+      return Result::UNSAT;
+    }
+  }
+
+  Result res;
+  TraceSpan span("Z3 check");
+  if (portfolio_size > 1) {
+    res = checkPortfolio();
+  } else {
+    tactic->check();
+    res = solve(s);
+  }
+
+  switch (res.a) {
+  case Result::UNSAT:   ++num_unsats; break;
+  case Result::SAT:     ++num_sats; break;
+  case Result::TIMEOUT: ++num_timeout; break;
+  default:              ++num_errors; break;
+  }
 
+  if (cache)
+    cache->store(res.a);
+  return res;
+}
+
+Result Solver::checkQuick(unsigned timeout_ms) const {
+  if (!valid)
+    return Result::INVALID;
+  if (is_unsat)
+    return Result::UNSAT;
+  if (config::skip_smt)
+    return Result::SKIP;
+
+  auto p = Z3_mk_params(ctx());
+  Z3_params_inc_ref(ctx(), p);
+  Z3_params_set_uint(ctx(), p, Z3_mk_string_symbol(ctx(), "timeout"),
+                     timeout_ms);
+  Z3_solver_set_params(ctx(), s, p);
+  Z3_params_dec_ref(ctx(), p);
+
+  TraceSpan span("Z3 quick check");
+  return solve(s);
+}
+
+Result Solver::solve(Z3_solver s) {
   switch (Z3_solver_check(ctx(), s)) {
   case Z3_L_FALSE:
-    ++num_unsats;
     return Result::UNSAT;
   case Z3_L_TRUE:
-    ++num_sats;
     return Z3_solver_get_model(ctx(), s);
   case Z3_L_UNDEF: {
     string_view reason = Z3_solver_get_reason_unknown(ctx(), s);
-    if (reason == "timeout") {
-      ++num_timeout;
+    if (reason == "timeout")
       return Result::TIMEOUT;
-    }
-    ++num_errors;
     return { Result::ERROR, string(reason) };
   }
   default:
@@ -344,19 +540,296 @@ Result Solver::check() const {
   }
 }
 
+// Races all portfolio configurations in child processes. The first
+// definitive answer wins and the remaining children are killed.
+// Children only report the answer, so the model of a SAT answer is
+// recomputed here with the winning configuration.
+Result Solver::checkPortfolio() const {
+  struct Worker {
+    pid_t pid;
+    int fd;
+    string out;
+  };
+  vector<Worker> workers;
+
+  // Creates the solver for the idx-th configuration of the portfolio.
+  // Configurations differ in tactics, random seed, and SMT core parameters.
+  auto mk_solver = [&](unsigned idx) {
+    auto c = ctx();
+    auto p = Z3_mk_params(c);
+    Z3_params_inc_ref(c, p);
+    auto set_param = [&](const char *name, unsigned val) {
+      Z3_params_set_uint(c, p, Z3_mk_string_symbol(c, name), val);
+    };
+    set_param("random_seed", strtoul(get_random_seed(), nullptr, 10) + idx);
+
+    Z3_solver ps;
+    if (idx == 2) {
+      // Z3's own auto-configured solver
+      ps = Z3_mk_solver(c);
+      Z3_solver_inc_ref(c, ps);
+      Z3_solver_set_params(c, ps, p);
+    } else {
+      switch (idx) {
+      case 3: set_param("phase_selection", 0); break;
+      case 4: set_param("relevancy", 0); break;
+      }
+
+      Z3_tactic t = tactic->t;
+      Z3_tactic_inc_ref(c, t);
+      if (idx == 1) {
+        // default pipeline, but bit-blast if the formula is quantifier-free
+        // after preprocessing
+        Tactic pre("skip");
+        for (auto name : default_tactics) {
+          if (string_view(name) != "smt")
+            pre = MultiTactic::mkThen(pre, Tactic(name));
+        }
+        Tactic bb(Z3_tactic_cond(c, Z3_mk_probe(c, "is-qfbv"),
+                                 Tactic("qfbv").t, Tactic("smt").t));
+        Tactic tt = MultiTactic::mkThen(pre, bb);
+        Z3_tactic_dec_ref(c, t);
+        t = tt.t;
+        Z3_tactic_inc_ref(c, t);
+      }
+      auto tp = Z3_tactic_using_params(c, t, p);
+      Z3_tactic_inc_ref(c, tp);
+      ps = Z3_mk_solver_from_tactic(c, tp);
+      Z3_solver_inc_ref(c, ps);
+      Z3_tactic_dec_ref(c, tp);
+      Z3_tactic_dec_ref(c, t);
+    }
+    Z3_params_dec_ref(c, p);
+    return ps;
+  };
+
+  auto run = [&](unsigned idx) -> Result {
+    auto ps = mk_solver(idx);
+    auto vect = Z3_solver_get_assertions(ctx(), s);
+    Z3_ast_vector_inc_ref(ctx(), vect);
+    for (unsigned i = 0, e = Z3_ast_vector_size(ctx(), vect); i != e; ++i) {
+      Z3_solver_assert(ctx(), ps, Z3_ast_vector_get(ctx(), vect, i));
+    }
+    Z3_ast_vector_dec_ref(ctx(), vect);
+
+    Result r = solve(ps);
+    Z3_solver_dec_ref(ctx(), ps);
+    return r;
+  };
+
+  // don't let children flush the parent's buffered output
+  fflush(nullptr);
+
+  for (unsigned i = 0; i < portfolio_size; ++i) {
+    int fds[2];
+    if (pipe(fds) < 0)
+      break;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+      close(fds[0]);
+      auto r = run(i);
+      string out = r.isUnsat() ? "u" : r.isSat() ? "s" :
+                   r.isTimeout() ? "t" : 'e' + r.getReason();
+      [[maybe_unused]] auto n = write(fds[1], out.data(), out.size());
+      close(fds[1]);
+      _exit(0);
+    }
+    close(fds[1]);
+    if (pid < 0) {
+      close(fds[0]);
+      break;
+    }
+    workers.push_back({ pid, fds[0], {} });
+  }
+
+  if (workers.empty())
+    return solve(s);
+
+  optional<unsigned> winner;
+  bool timeout = false;
+  string reason;
+
+  for (unsigned running = workers.size(); running > 0 && !winner; ) {
+    vector<pollfd> pfds;
+    vector<unsigned> idxs;
+    for (unsigned i = 0, e = workers.size(); i != e; ++i) {
+      if (workers[i].fd >= 0) {
+        pfds.push_back({ workers[i].fd, POLLIN, 0 });
+        idxs.push_back(i);
+      }
+    }
+    if (poll(pfds.data(), pfds.size(), -1) < 0)
+      continue;
+
+    for (unsigned i = 0, e = pfds.size(); i != e && !winner; ++i) {
+      if (!pfds[i].revents)
+        continue;
+      auto &w = workers[idxs[i]];
+      char buf[256];
+      auto n = read(w.fd, buf, sizeof(buf));
+      if (n > 0) {
+        w.out.append(buf, n);
+        continue;
+      }
+      close(w.fd);
+      w.fd = -1;
+      --running;
+
+      if (w.out.empty())
+        continue; // child crashed; treat as no answer
+      switch (w.out[0]) {
+      case 'u':
+      case 's': winner = idxs[i]; break;
+      case 't': timeout = true; break;
+      default:  reason = w.out.substr(1); break;
+      }
+    }
+  }
+
+  for (auto &w : workers) {
+    if (w.fd >= 0) {
+      kill(w.pid, SIGKILL);
+      close(w.fd);
+    }
+    waitpid(w.pid, nullptr, 0);
+  }
+
+  if (winner) {
+    if (workers[*winner].out[0] == 'u')
+      return Result::UNSAT;
+    return run(*winner);
+  }
+  if (timeout)
+    return Result::TIMEOUT;
+  return { Result::ERROR, move(reason) };
+}
+
 Result check_expr(const expr &e) {
   Solver s;
   s.add(e);
   return s.check();
 }
 
+// Each query runs in a child process; children only report the answer, so
+// the model of the first satisfiable query is recomputed here.
+pair<unsigned, Result> check_exprs(const vector<expr> &es, unsigned jobs) {
+  struct Worker {
+    pid_t pid;
+    int fd;
+    unsigned idx;
+    string out;
+  };
+  vector<Worker> workers;
+  // answer of each query: 'u', 's', 't', 'e', or 0 if not known yet
+  vector<char> answers(es.size(), 0);
+  unsigned next = 0, first = 0;
+
+  // skip the queries that are already known to be unsat
+  auto advance = [&]() {
+    while (first < es.size() && answers[first] == 'u')
+      ++first;
+  };
+
+  fflush(nullptr);
+
+  while (true) {
+    advance();
+    if (first == es.size() || answers[first] != 0)
+      break;
+
+    while (next < es.size() && workers.size() < max(jobs, 1u)) {
+      unsigned idx = next++;
+      int fds[2];
+      pid_t pid = -1;
+      if (jobs > 1 && pipe(fds) == 0) {
+        pid = fork();
+        if (pid == 0) {
+          close(fds[0]);
+          auto r = check_expr(es[idx]);
+          char c = r.isUnsat() ? 'u' : r.isSat() ? 's' :
+                   r.isTimeout() ? 't' : 'e';
+          [[maybe_unused]] auto n = write(fds[1], &c, 1);
+          close(fds[1]);
+          _exit(0);
+        }
+        close(fds[1]);
+        if (pid < 0)
+          close(fds[0]);
+      }
+      if (pid < 0) {
+        // sequential mode, or couldn't fork
+        auto r = check_expr(es[idx]);
+        if (!r.isUnsat()) {
+          answers[idx] = 's';
+          if (idx == first) {
+            for (auto &w : workers) {
+              kill(w.pid, SIGKILL);
+              close(w.fd);
+              waitpid(w.pid, nullptr, 0);
+            }
+            return { idx, move(r) };
+          }
+        } else {
+          answers[idx] = 'u';
+        }
+        advance();
+        continue;
+      }
+      workers.push_back({ pid, fds[0], idx, {} });
+    }
+
+    if (workers.empty())
+      continue;
 
-SolverPush::SolverPush(Solver &s) : s(s) {
+    vector<pollfd> pfds;
+    for (auto &w : workers) {
+      pfds.push_back({ w.fd, POLLIN, 0 });
+    }
+    if (poll(pfds.data(), pfds.size(), -1) < 0)
+      continue;
+
+    for (unsigned i = pfds.size(); i-- > 0; ) {
+      if (!pfds[i].revents)
+        continue;
+      auto &w = workers[i];
+      char buf[16];
+      auto n = read(w.fd, buf, sizeof(buf));
+      if (n > 0) {
+        w.out.append(buf, n);
+        continue;
+      }
+      close(w.fd);
+      waitpid(w.pid, nullptr, 0);
+      // a crashed child is treated as an error
+      answers[w.idx] = w.out.empty() ? 'e' : w.out[0];
+      workers.erase(workers.begin() + i);
+    }
+  }
+
+  for (auto &w : workers) {
+    kill(w.pid, SIGKILL);
+    close(w.fd);
+    waitpid(w.pid, nullptr, 0);
+  }
+
+  if (first == es.size())
+    return { first, Result(Result::UNSAT) };
+  if (answers[first] == 't')
+    return { first, Result(Result::TIMEOUT) };
+  return { first, check_expr(es[first]) };
+}
+
+
+SolverPush::SolverPush(Solver &s)
+  : s(s), valid(s.valid), is_unsat(s.is_unsat) {
   Z3_solver_push(ctx(), s.s);
 }
 
 SolverPush::~SolverPush() {
   Z3_solver_pop(ctx(), s.s, 1);
+  s.valid = valid;
+  s.is_unsat = is_unsat;
 }
 
 
@@ -379,6 +852,9 @@ void solver_print_stats(ostream &os) {
         "Num errors:  " << num_errors << " (" << error_pc << "%)\n"
         "Num SAT:     " << num_sats << " (" << sat_pc << "%)\n"
         "Num UNSAT:   " << num_unsats << " (" << unsat_pc << "%)\n";
+  if (!config::smt_cache_dir.empty())
+    os << "Cache hits:  " << num_cache_hits << '\n';
+  ExprSubst::printStats(os);
 }
 
 
@@ -392,19 +868,13 @@ EnableSMTQueriesTMP::~EnableSMTQueriesTMP() {
 
 
 void solver_init() {
-  tactic.emplace({
-    "simplify",
-    "propagate-values",
-    "simplify",
-    "elim-uncnstr",
-    "qe-light",
-    "simplify",
-    "elim-uncnstr",
-    "reduce-args",
-    "qe-light",
-    "simplify",
-    "smt"
-  });
+  tactic.emplace(default_tactics);
+
+  tactic_desc.clear();
+  for (auto t : default_tactics) {
+    tactic_desc += t;
+    tactic_desc += ';';
+  }
 }
 
 void solver_destroy() {
@@ -8,6 +8,7 @@
 #include <ostream>
 #include <string>
 #include <utility>
+#include <vector>
 
 typedef struct _Z3_model* Z3_model;
 typedef struct _Z3_solver* Z3_solver;
@@ -85,6 +86,8 @@ private:
   Result(Z3_model m) : m(m), a(SAT) {}
 
   friend class Solver;
+  friend std::pair<unsigned, Result> check_exprs(const std::vector<expr> &es,
+                                                 unsigned jobs);
 };
 
 
@@ -93,6 +96,9 @@ class Solver {
   bool valid = true;
   bool is_unsat = false;
 
+  static Result solve(Z3_solver s);
+  Result checkPortfolio() const;
+
 public:
   Solver(bool simple = false);
   ~Solver();
@@ -105,15 +111,26 @@ public:
   expr assertions() const;
 
   Result check() const;
+  // check with a small time budget, e.g., for cheap pruning during symbolic
+  // execution; bypasses the cache, benchmark dumping, and the portfolio
+  Result checkQuick(unsigned timeout_ms) const;
 
   friend class SolverPush;
 };
 
 Result check_expr(const expr &e);
 
+// Checks each formula separately, running up to jobs queries in parallel.
+// Returns the index and the result of the first formula that is not unsat,
+// or es.size() and UNSAT if all of them are.
+std::pair<unsigned, Result> check_exprs(const std::vector<expr> &es,
+                                        unsigned jobs);
+
 
+// Scoped push/pop; the trivial unsat/invalid flags are restored on pop too
 class SolverPush {
   Solver &s;
+  bool valid, is_unsat;
 public:
   SolverPush(Solver &s);
   ~SolverPush();
@@ -122,6 +139,8 @@ public:
 
 void solver_print_queries(bool yes);
 void solver_tactic_verbose(bool yes);
+// race this many solver configurations per query (1 = disabled)
+void solver_portfolio(unsigned size);
 void solver_print_stats(std::ostream &os);
 
 
@@ -0,0 +1,38 @@
+; TEST-ARGS: -loop-induction -disable-undef-input -src-unroll=2 -tgt-unroll=2
+; ERROR: Source is more defined than target
+
+define i8 @src(i1 %c, i8 %n) {
+entry:
+  br i1 %c, label %for.end, label %for.cond
+
+for.cond:
+  %i = phi i8 [ 0, %entry ], [ %inc, %for.body ]
+  %cmp = icmp ult i8 %i, %n
+  br i1 %cmp, label %for.body, label %for.end
+
+for.body:
+  %inc = add i8 %i, 1
+  br label %for.cond
+
+for.end:
+  ret i8 0
+}
+
+define i8 @tgt(i1 %c, i8 %n) {
+entry:
+  %d = select i1 %c, i8 0, i8 1
+  br label %for.cond
+
+for.cond:
+  %i = phi i8 [ 0, %entry ], [ %inc, %for.body ]
+  %cmp = icmp ult i8 %i, %n
+  br i1 %cmp, label %for.body, label %for.end
+
+for.body:
+  %q = udiv i8 1, %d
+  %inc = add i8 %i, %q
+  br label %for.cond
+
+for.end:
+  ret i8 0
+}
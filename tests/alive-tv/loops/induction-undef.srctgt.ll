@@ -0,0 +1,33 @@
+; TEST-ARGS: -loop-induction -disable-undef-input -src-unroll=2 -tgt-unroll=2
+; ERROR: Value mismatch
+
+define i8 @src(i8 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i8 [ 0, %entry ], [ %inc, %loop ]
+  %p = phi i8 [ undef, %entry ], [ %p, %loop ]
+  %inc = add i8 %i, 1
+  %cmp = icmp ult i8 %inc, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  ret i8 0
+}
+
+define i8 @tgt(i8 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i8 [ 0, %entry ], [ %inc, %loop ]
+  %p = phi i8 [ undef, %entry ], [ %p, %loop ]
+  %inc = add i8 %i, 1
+  %cmp = icmp ult i8 %inc, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  %r = sub i8 %p, %p
+  ret i8 %r
+}
@@ -0,0 +1,41 @@
+; TEST-ARGS: -loop-induction -disable-undef-input
+
+define i8 @src(i8 %n, i8 %x, i8 %y) {
+entry:
+  br label %for.cond
+
+for.cond:
+  %i = phi i8 [ 0, %entry ], [ %inc, %for.body ]
+  %acc = phi i8 [ 0, %entry ], [ %acc.next, %for.body ]
+  %cmp = icmp ult i8 %i, 100
+  br i1 %cmp, label %for.body, label %for.end
+
+for.body:
+  %m = mul i8 %x, %y
+  %acc.next = add i8 %acc, %m
+  %inc = add i8 %i, 1
+  br label %for.cond
+
+for.end:
+  ret i8 %acc
+}
+
+define i8 @tgt(i8 %n, i8 %x, i8 %y) {
+entry:
+  %m = mul i8 %x, %y
+  br label %for.cond
+
+for.cond:
+  %i = phi i8 [ 0, %entry ], [ %inc, %for.body ]
+  %acc = phi i8 [ 0, %entry ], [ %acc.next, %for.body ]
+  %cmp = icmp ult i8 %i, 100
+  br i1 %cmp, label %for.body, label %for.end
+
+for.body:
+  %acc.next = add i8 %acc, %m
+  %inc = add i8 %i, 1
+  br label %for.cond
+
+for.end:
+  ret i8 %acc
+}
@@ -0,0 +1,25 @@
+; TEST-ARGS: -src-unroll=8 -tgt-unroll=8 -unroll-deepen
+; ERROR: Value mismatch
+
+define i8 @src(i8 %x) {
+entry:
+  %n = urem i8 %x, 3
+  br label %for.cond
+
+for.cond:
+  %i = phi i8 [ 0, %entry ], [ %inc, %for.body ]
+  %cmp = icmp ult i8 %i, %n
+  br i1 %cmp, label %for.body, label %for.end
+
+for.body:
+  %inc = add i8 %i, 1
+  br label %for.cond
+
+for.end:
+  ret i8 %i
+}
+
+define i8 @tgt(i8 %x) {
+  %n = urem i8 %x, 2
+  ret i8 %n
+}
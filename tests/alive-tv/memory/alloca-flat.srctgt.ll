@@ -0,0 +1,22 @@
+; TEST-ARGS: -alias-stats
+
+define i16 @src(i16 %x, i1 %c) {
+  %p = alloca i32
+  %q = bitcast i32* %p to i16*
+  %r = getelementptr i16, i16* %q, i64 1
+  store i32 0, i32* %p
+  br i1 %c, label %A, label %B
+A:
+  store i16 %x, i16* %r
+  br label %B
+B:
+  %v = load i16, i16* %r
+  ret i16 %v
+}
+
+define i16 @tgt(i16 %x, i1 %c) {
+  %v = select i1 %c, i16 %x, i16 0
+  ret i16 %v
+}
+
+; CHECK: Local block encoding
@@ -0,0 +1,14 @@
+; TEST-ARGS: -concrete-tests=4
+target datalayout = "E"
+
+define i8 @src() {
+  %a = alloca i32
+  store i32 16909060, i32* %a
+  %b = bitcast i32* %a to i8*
+  %v = load i8, i8* %b
+  ret i8 %v
+}
+
+define i8 @tgt() {
+  ret i8 1
+}
@@ -0,0 +1,12 @@
+; TEST-ARGS: -concrete-tests=4
+target datalayout = "e-p:32:32:32"
+
+define i8 @src() {
+  ret i8 0
+}
+
+define i8 @tgt() {
+  %a = alloca i8*
+  store i8* null, i8** %a
+  ret i8 0
+}
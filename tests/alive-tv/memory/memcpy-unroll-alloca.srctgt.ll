@@ -0,0 +1,26 @@
+; TEST-ARGS: -memop-unroll=32
+
+define i8 @src() {
+  %a = alloca [16 x i8]
+  %b = alloca [16 x i8]
+  %pa = bitcast [16 x i8]* %a to i8*
+  %pb = bitcast [16 x i8]* %b to i8*
+  call void @llvm.memset.p0i8.i64(i8* %pa, i8 7, i64 16, i1 false)
+  %a3 = getelementptr i8, i8* %pa, i64 3
+  store i8 5, i8* %a3
+  %b2 = getelementptr i8, i8* %pb, i64 2
+  call void @llvm.memcpy.p0i8.p0i8.i64(i8* %b2, i8* %pa, i64 8, i1 false)
+  %b5 = getelementptr i8, i8* %pb, i64 5
+  %v = load i8, i8* %b5
+  %b9 = getelementptr i8, i8* %pb, i64 9
+  %w = load i8, i8* %b9
+  %r = add i8 %v, %w
+  ret i8 %r
+}
+
+define i8 @tgt() {
+  ret i8 12
+}
+
+declare void @llvm.memset.p0i8.i64(i8*, i8, i64, i1)
+declare void @llvm.memcpy.p0i8.p0i8.i64(i8*, i8*, i64, i1)
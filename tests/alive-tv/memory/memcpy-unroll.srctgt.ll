@@ -0,0 +1,23 @@
+; TEST-ARGS: -memop-unroll=32
+
+define i8 @src(i8* %p) {
+  %a = alloca [32 x i8]
+  %b = bitcast [32 x i8]* %a to i8*
+  call void @llvm.memset.p0i8.i64(i8* %b, i8 0, i64 32, i1 false)
+  call void @llvm.memcpy.p0i8.p0i8.i64(i8* %b, i8* %p, i64 32, i1 false)
+  %q = getelementptr i8, i8* %b, i64 20
+  %v = load i8, i8* %q
+  ret i8 %v
+}
+
+define i8 @tgt(i8* %p) {
+  %a = alloca [32 x i8]
+  %b = bitcast [32 x i8]* %a to i8*
+  call void @llvm.memcpy.p0i8.p0i8.i64(i8* %b, i8* %p, i64 32, i1 false)
+  %q = getelementptr i8, i8* %p, i64 20
+  %v = load i8, i8* %q
+  ret i8 %v
+}
+
+declare void @llvm.memset.p0i8.i64(i8*, i8, i64, i1)
+declare void @llvm.memcpy.p0i8.p0i8.i64(i8*, i8*, i64, i1)
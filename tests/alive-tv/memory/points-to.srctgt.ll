@@ -0,0 +1,28 @@
+; TEST-ARGS: -points-to
+
+define i8 @src(i1 %c, i8* %p) {
+  %a = alloca i8
+  %b = alloca i8
+  %slot = alloca i8*
+  store i8 0, i8* %a
+  store i8 0, i8* %b
+  br i1 %c, label %A, label %B
+A:
+  store i8* %a, i8** %slot
+  br label %C
+B:
+  store i8* %b, i8** %slot
+  br label %C
+C:
+  %q = load i8*, i8** %slot
+  store i8 1, i8* %q
+  store i8 2, i8* %p
+  %v = load i8, i8* %a
+  ret i8 %v
+}
+
+define i8 @tgt(i1 %c, i8* %p) {
+  store i8 2, i8* %p
+  %v = select i1 %c, i8 1, i8 0
+  ret i8 %v
+}
@@ -0,0 +1,19 @@
+; TEST-ARGS: -smt-split-memory=2
+; ERROR: Mismatch in memory
+
+@x = global i8 0
+@y = global i8 0
+
+define void @src(i8* %p) {
+  store i8 1, i8* @x
+  store i8 2, i8* @y
+  store i8 3, i8* %p
+  ret void
+}
+
+define void @tgt(i8* %p) {
+  store i8 1, i8* @x
+  store i8 3, i8* @y
+  store i8 3, i8* %p
+  ret void
+}
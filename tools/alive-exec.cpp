@@ -5,6 +5,7 @@
 #include "smt/expr.h"
 #include "smt/smt.h"
 #include "smt/solver.h"
+#include "tools/interpreter.h"
 #include "tools/transform.h"
 #include "util/version.h"
 
@@ -25,6 +26,9 @@
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <utility>
@@ -44,9 +48,86 @@ llvm::cl::opt<string> opt_file(llvm::cl::Positional,
   llvm::cl::desc("bitcode_file"), llvm::cl::Required,
   llvm::cl::value_desc("filename"), llvm::cl::cat(alive_cmdargs));
 
+llvm::cl::list<string> opt_inputs("input",
+  llvm::cl::desc("Comma-separated input values to execute the functions "
+                 "with (can be given multiple times)"),
+  llvm::cl::value_desc("values"), llvm::cl::cat(alive_cmdargs));
+
+llvm::cl::opt<string> opt_input_file("input-file",
+  llvm::cl::desc("File with one list of input values per line"),
+  llvm::cl::value_desc("filename"), llvm::cl::cat(alive_cmdargs));
+
+llvm::cl::opt<unsigned> opt_max_steps("max-steps",
+  llvm::cl::desc("Maximum number of instructions to execute natively "
+                 "(default=10000000)"),
+  llvm::cl::init(10000000), llvm::cl::cat(alive_cmdargs));
+
+llvm::cl::opt<bool> opt_smt_exec("smt-exec",
+  llvm::cl::desc("Always execute symbolically with the SMT solver"),
+  llvm::cl::init(false), llvm::cl::cat(alive_cmdargs));
+
 
 llvm::ExitOnError ExitOnErr;
 
+vector<vector<string>> input_vectors;
+
+vector<string> split_inputs(const string &line) {
+  vector<string> vals;
+  string val;
+  for (char c : line) {
+    if (c == ',' || isspace((unsigned char)c)) {
+      if (!val.empty())
+        vals.emplace_back(move(val));
+      val.clear();
+    } else {
+      val += c;
+    }
+  }
+  if (!val.empty())
+    vals.emplace_back(move(val));
+  return vals;
+}
+
+bool read_input_file(const string &filename) {
+  ifstream f(filename);
+  if (!f)
+    return false;
+
+  string line;
+  while (getline(f, line)) {
+    if (auto vals = split_inputs(line); !vals.empty() && vals[0][0] != '#')
+      input_vectors.emplace_back(move(vals));
+  }
+  return true;
+}
+
+// Accepts integers (decimal or hex, either signed or unsigned) and poison.
+bool parse_input(const string &str, const IR::Type &ty, ConcreteVal &v) {
+  if (!ty.isIntType() || ty.bits() > 64)
+    return false;
+
+  unsigned bits = ty.bits();
+  uint64_t mask = bits == 64 ? ~0ull : (1ull << bits) - 1;
+  if (str == "poison") {
+    v = { 0, bits, true };
+    return true;
+  }
+
+  char *end;
+  errno = 0;
+  bool neg = str[0] == '-';
+  uint64_t n = neg ? (uint64_t)strtoll(str.c_str(), &end, 0)
+                   : strtoull(str.c_str(), &end, 0);
+  if (errno || *end || end == str.c_str())
+    return false;
+  if (bits < 64 &&
+      (neg ? (int64_t)n < -(int64_t)(1ull << (bits - 1)) : n > mask))
+    return false;
+
+  v = { n & mask, bits };
+  return true;
+}
+
 // adapted from llvm-dis.cpp
 std::unique_ptr<llvm::Module> openInputFile(llvm::LLVMContext &Context,
                                             const string &InputFilename) {
@@ -65,38 +146,42 @@ std::unique_ptr<llvm::Module> openInputFile(llvm::LLVMContext &Context,
 
 optional<smt::smt_initializer> smt_init;
 
-void execFunction(llvm::Function &F, llvm::TargetLibraryInfoWrapperPass &TLI,
-                  unsigned &successCount, unsigned &errorCount) {
-  auto Func = llvm2alive(F, TLI.getTLI(F));
-  if (!Func) {
-    cerr << "ERROR: Could not translate '" << F.getName().str()
-         << "' to Alive IR\n";
-    ++errorCount;
-    return;
-  }
-  if (opt_print_dot) {
-    Func->writeDot("");
+// Runs the function natively. Returns false if the input values can't be
+// handled concretely (e.g., undef) or if the execution reaches something the
+// interpreter doesn't support, so the SMT solver is needed.
+bool execConcrete(Interpreter &interp, const IR::Function &f,
+                  const vector<string> &vals, bool &ok) {
+  unordered_map<string, ConcreteVal> inputs;
+  unsigned idx = 0;
+  for (auto &in : f.getInputs()) {
+    if (idx >= vals.size() ||
+        !parse_input(vals[idx++], in.getType(), inputs[in.getName()]))
+      return false;
   }
 
-  Transform t;
-  t.src = move(*Func);
-  t.tgt = *llvm2alive(F, TLI.getTLI(F));
-  t.preprocess();
-  TransformVerify verifier(t, false);
-  if (!opt_quiet)
-    t.src.print(cout << "\n----------------------------------------\n");
-
-  {
-    auto types = verifier.getTypings();
-    if (!types) {
-      cerr << "Transformation doesn't verify!\n"
-              "ERROR: program doesn't type check!\n\n";
-      ++errorCount;
-      return;
-    }
-    assert(types.hasSingleTyping());
+  switch (interp.run(inputs, opt_max_steps)) {
+  case Interpreter::Done:
+    cout << "Return value: ";
+    if (&f.getType() == &IR::Type::voidTy)
+      cout << "void";
+    else
+      cout << interp.getReturnVal();
+    cout << "\n\n";
+    return true;
+
+  case Interpreter::UB:
+    cout << "ERROR: Function has undefined behavior\n\n";
+    ok = false;
+    return true;
+
+  case Interpreter::Unsupported:
+    return false;
   }
+  UNREACHABLE();
+}
 
+bool execSMT(Transform &t, TransformVerify &verifier,
+             const vector<string> &vals) {
   smt_init->reset();
   try {
     auto p = verifier.exec();
@@ -107,33 +192,50 @@ void execFunction(llvm::Function &F, llvm::TargetLibraryInfoWrapperPass &TLI,
     auto ret = expr::mkVar("ret_val", ret_val.value);
     auto ret_np = expr::mkVar("ret_np", ret_val.non_poison);
 
+    // fix the inputs that were given; undef is left unconstrained
+    expr inputs = true;
+    unsigned idx = 0;
+    for (auto &in : t.src.getInputs()) {
+      if (idx >= vals.size())
+        break;
+      auto &str = vals[idx++];
+      auto &[v, np] = state.at(in).first;
+      if (str == "undef") {
+        inputs &= np;
+        continue;
+      }
+      ConcreteVal c;
+      if (!parse_input(str, in.getType(), c)) {
+        cout << "ERROR: Invalid value for " << in.getName() << ": " << str
+             << '\n';
+        return false;
+      }
+      inputs &= c.poison ? !np : np && v == expr::mkUInt(c.val, c.bits);
+    }
+
     Solver s;
     s.add(ret_domain);
+    s.add(inputs);
     auto r = s.check();
     if (r.isUnsat()) {
       cout << "ERROR: Function doesn't reach a return statement\n";
-      ++errorCount;
-      return;
+      return false;
     }
     if (r.isInvalid()) {
       cout << "ERROR: invalid expression\n";
-      ++errorCount;
-      return;
+      return false;
     }
     if (r.isError()) {
       cout << "ERROR: Error in SMT solver: " << r.getReason() << '\n';
-      ++errorCount;
-      return;
+      return false;
     }
     if (r.isTimeout()) {
       cout << "ERROR: SMT solver timedout\n";
-      ++errorCount;
-      return;
+      return false;
     }
     if (r.isSkip()) {
       cout << "ERROR: SMT queries disabled";
-      ++errorCount;
-      return;
+      return false;
     }
     if (r.isSat()) {
       auto &m = r.getModel();
@@ -150,16 +252,83 @@ void execFunction(llvm::Function &F, llvm::TargetLibraryInfoWrapperPass &TLI,
         }
         cout << "\n\n";
       }
-      ++successCount;
-      return;
+      return true;
     }
     UNREACHABLE();
 
   } catch (const AliveException &e) {
     cout << "ERROR: " << e.msg << '\n';
+    return false;
+  }
+}
+
+void execFunction(llvm::Function &F, llvm::TargetLibraryInfoWrapperPass &TLI,
+                  unsigned &successCount, unsigned &errorCount) {
+  auto Func = llvm2alive(F, TLI.getTLI(F));
+  if (!Func) {
+    cerr << "ERROR: Could not translate '" << F.getName().str()
+         << "' to Alive IR\n";
     ++errorCount;
     return;
   }
+  if (opt_print_dot) {
+    Func->writeDot("");
+  }
+
+  // the interpreter runs the function before loops are unrolled
+  auto native = llvm2alive(F, TLI.getTLI(F));
+
+  Transform t;
+  t.src = move(*Func);
+  t.tgt = *llvm2alive(F, TLI.getTLI(F));
+  t.preprocess();
+  TransformVerify verifier(t, false);
+  if (!opt_quiet)
+    t.src.print(cout << "\n----------------------------------------\n");
+
+  {
+    auto types = verifier.getTypings();
+    if (!types) {
+      cerr << "Transformation doesn't verify!\n"
+              "ERROR: program doesn't type check!\n\n";
+      ++errorCount;
+      return;
+    }
+    assert(types.hasSingleTyping());
+  }
+
+  unsigned num_inputs = 0;
+  for (auto &in : t.src.getInputs()) {
+    (void)in;
+    ++num_inputs;
+  }
+
+  // without inputs, run once with the arguments unconstrained
+  static const vector<vector<string>> no_inputs(1);
+  auto &vectors = input_vectors.empty() ? no_inputs : input_vectors;
+
+  Interpreter interp(*native, false);
+  bool ok = true;
+  for (auto &vals : vectors) {
+    if (!input_vectors.empty()) {
+      if (vals.size() != num_inputs) {
+        cout << "ERROR: Expected " << num_inputs << " input values, got "
+             << vals.size() << '\n';
+        ok = false;
+        continue;
+      }
+      cout << "Inputs:";
+      for (auto &v : vals) {
+        cout << ' ' << v;
+      }
+      cout << '\n';
+    }
+
+    if (!opt_smt_exec && execConcrete(interp, *native, vals, ok))
+      continue;
+    ok &= execSMT(t, verifier, vals);
+  }
+  ++(ok ? successCount : errorCount);
 }
 }
 
@@ -182,10 +351,15 @@ argument. Both .bc and .ll files are supported.
 
 If one or more functions are specified (as a comma-separated list)
 using the --funcs command line option, alive-exec will attempt to
-execute them using Alive2 as an interpreter. There are currently many
-restrictions on what kind of functions can be executed: they cannot
-take inputs, cannot use memory, cannot depend on undefined behaviors,
-and cannot include loops that execute too many iterations.
+execute them using Alive2 as an interpreter.
+
+Input values are given with --input (a comma-separated list, one value
+per argument; the option can be repeated) or --input-file (one list per
+line). Values are integers, poison, or undef. Each list is executed
+natively with a concrete interpreter that supports integers and allocas;
+anything else, including undef and other nondeterministic constructs,
+falls back to symbolic execution with the SMT solver, which cannot run
+loops for more iterations than the unroll bound.
 
 If no functions are specified on the command line, then alive-exec
 will attempt to execute every function in the bitcode file.
@@ -203,6 +377,14 @@ will attempt to execute every function in the bitcode file.
 #define ARGS_MODULE_VAR M
 # include "llvm_util/cmd_args_def.h"
 
+  for (auto &vals : opt_inputs) {
+    input_vectors.emplace_back(split_inputs(vals));
+  }
+  if (!opt_input_file.empty() && !read_input_file(opt_input_file)) {
+    cerr << "Could not read inputs from '" << opt_input_file << "'\n";
+    return -1;
+  }
+
   auto &DL = M.get()->getDataLayout();
   llvm::Triple targetTriple(M.get()->getTargetTriple());
   llvm::TargetLibraryInfoWrapperPass TLI(targetTriple);
@@ -6,6 +6,7 @@
 #include "tools/alive_parser.h"
 #include "util/config.h"
 #include "util/file.h"
+#include "util/trace.h"
 #include "util/version.h"
 #include <cstdlib>
 #include <iostream>
@@ -29,11 +30,21 @@ static void show_help() {
           " -smt-stats\t\tShow SMT statistics\n"
           " -smt-to:x\t\tTimeout for SMT queries in ms\n"
           " -smt-random-seed:x\tRandom seed for the SMT solver\n"
+          " -smt-portfolio:n\tRace n solver configurations per query\n"
           " -max-mem:x\t\tMax memory consumption in MB (aprox)\n"
           " -smt-verbose\t\tPrint all SMT queries\n"
           " -tactic-verbose\tDebug SMT tactics\n"
           " -smt-log\t\tLog interactions with the SMT solver\n"
           " -skip-smt\t\tSkip all SMT queries\n"
+          " -smt-cache:dir\t\tCache SMT query results across runs\n"
+          " -smt-incremental\tUse a single incremental solver per transform\n"
+          " -concrete-tests:n\tTry n concrete inputs before calling SMT\n"
+          " -adaptive-widths\tTry narrow pointer offsets first\n"
+          " -lockstep\t\tTry the same undef values in identical src/tgt "
+          "instructions first\n"
+          " -slice\t\t\tTry first with identical src/tgt instructions "
+          "abstracted\n"
+          " -trace:file\t\tWrite a Chrome trace of the verification phases\n"
           " -disable-poison-input\tAssume input variables can never be poison\n"
           " -disable-undef-input\tAssume input variables can never be undef\n"
           " -h / --help / -v / --version\tShow this help\n";
@@ -61,6 +72,8 @@ int main(int argc, char **argv) {
       smt::set_query_timeout(arg.substr(8).data());
     else if (arg.compare(0, 17, "-smt-random-seed:") == 0 && arg.size() > 17)
       smt::set_random_seed(arg.substr(17).data());
+    else if (arg.compare(0, 15, "-smt-portfolio:") == 0 && arg.size() > 15)
+      smt::solver_portfolio(strtoul(arg.substr(15).data(), nullptr, 10));
     else if (arg.compare(0, 9, "-max-mem:") == 0 && arg.size() > 9)
       smt::set_memory_limit(strtoul(arg.substr(9).data(), nullptr, 10) *
                             1024 * 1024);
@@ -72,6 +85,20 @@ int main(int argc, char **argv) {
       smt::start_logging();
     else if (arg == "-skip-smt")
       config::skip_smt = true;
+    else if (arg == "-smt-incremental")
+      config::incremental_refinement = true;
+    else if (arg.compare(0, 11, "-smt-cache:") == 0 && arg.size() > 11)
+      config::smt_cache_dir = arg.substr(11);
+    else if (arg.compare(0, 16, "-concrete-tests:") == 0 && arg.size() > 16)
+      config::concrete_tests = strtoul(arg.substr(16).data(), nullptr, 10);
+    else if (arg == "-adaptive-widths")
+      config::adaptive_widths = true;
+    else if (arg == "-lockstep")
+      config::lockstep = true;
+    else if (arg == "-slice")
+      config::slice = true;
+    else if (arg.compare(0, 7, "-trace:") == 0 && arg.size() > 7)
+      trace::start(string(arg.substr(7)));
     else if (arg == "-disable-undef-input")
       config::disable_undef_input = true;
     else if (arg == "-disable-poison-input")
@@ -0,0 +1,699 @@
+// Copyright (c) 2018-present The Alive2 Authors.
+// Distributed under the MIT license that can be found in the LICENSE file.
+
+#include "tools/interpreter.h"
+#include "ir/constant.h"
+#include "ir/function.h"
+#include "ir/instr.h"
+#include "smt/expr.h"
+#include <algorithm>
+#include <bit>
+
+using namespace IR;
+using namespace smt;
+using namespace std;
+using namespace tools;
+
+namespace {
+
+// thrown when the execution reaches something the interpreter can't handle
+struct unsupported {};
+
+// larger allocations are not worth simulating byte by byte
+constexpr uint64_t max_alloc_size = 1 << 24;
+
+uint64_t mask(unsigned bits) {
+  return bits >= 64 ? ~0ull : (1ull << bits) - 1;
+}
+
+int64_t sext(uint64_t v, unsigned bits) {
+  return bits >= 64 ? (int64_t)v : (int64_t)(v << (64 - bits)) >> (64 - bits);
+}
+
+uint64_t int_smin(unsigned bits) {
+  return 1ull << (bits - 1);
+}
+
+uint64_t int_smax(unsigned bits) {
+  return mask(bits) >> 1;
+}
+
+bool fits_signed(__int128 v, unsigned bits) {
+  __int128 lim = (__int128)1 << (bits - 1);
+  return v >= -lim && v < lim;
+}
+
+uint64_t clamp_signed(__int128 v, unsigned bits) {
+  if (v < -(__int128)int_smin(bits))
+    return int_smin(bits);
+  if (v > (__int128)int_smax(bits))
+    return int_smax(bits);
+  return (uint64_t)v;
+}
+
+unsigned int_bits(const Type &ty) {
+  if (!ty.isIntType() || ty.bits() > 64)
+    throw unsupported();
+  return ty.bits();
+}
+
+}
+
+namespace tools {
+
+ostream& operator<<(ostream &os, const ConcreteVal &v) {
+  if (v.poison)
+    return os << "poison";
+
+  if (v.ptr) {
+    if (v.bid == 0 && v.val == 0)
+      return os << "null";
+    return os << "pointer(local, block_id=" << v.bid << ", offset="
+              << (int64_t)v.val << ')';
+  }
+
+  auto e = expr::mkUInt(v.val, v.bits);
+  e.printHexadecimal(os);
+  os << " (";
+  e.printUnsigned(os);
+  if (v.bits > 1 && sext(v.val, v.bits) < 0) {
+    os << ", ";
+    e.printSigned(os);
+  }
+  return os << ')';
+}
+
+Interpreter::Interpreter(const Function &f, bool record_trace)
+  : f(f), ptr_bytes(f.bitsPointers() / 8),
+    little_endian(f.isLittleEndian()), record_trace(record_trace) {}
+
+ConcreteVal
+Interpreter::mkPtr(unsigned bid, uint64_t offset, bool poison) const {
+  return { offset, ptr_bytes * 8, poison, true, bid };
+}
+
+ConcreteVal Interpreter::get(const Value &v) const {
+  if (auto I = vals.find(&v); I != vals.end())
+    return I->second;
+
+  if (v.getType().isPtrType()) {
+    if (dynamic_cast<const NullPointerValue*>(&v))
+      return mkPtr(0, 0);
+    if (dynamic_cast<const PoisonValue*>(&v))
+      return mkPtr(0, 0, true);
+    throw unsupported();
+  }
+
+  unsigned bits = int_bits(v.getType());
+  if (auto *c = dynamic_cast<const IntConst*>(&v)) {
+    if (auto n = c->getInt())
+      return { (uint64_t)*n & mask(bits), bits };
+  } else if (dynamic_cast<const PoisonValue*>(&v)) {
+    return { 0, bits, true };
+  } else if (dynamic_cast<const Input*>(&v) ||
+             dynamic_cast<const ConstantInput*>(&v)) {
+    if (auto I = inputs->find(v.getName());
+        I != inputs->end() && I->second.bits == bits)
+      return I->second;
+  }
+  throw unsupported();
+}
+
+void Interpreter::set(const Instr &i, ConcreteVal v) {
+  vals[&i] = v;
+  if (record_trace)
+    trace.emplace_back(&i, v);
+}
+
+Interpreter::Block*
+Interpreter::deref(const ConcreteVal &p, uint64_t bytes, unsigned align) {
+  if (p.poison || p.bid == 0)
+    return nullptr;
+
+  auto &b = blocks[p.bid];
+  if (!b.alive || p.val > b.bytes.size() || bytes > b.bytes.size() - p.val)
+    return nullptr;
+
+  // the address of the block is only known to be aligned to b.align
+  if (align > b.align)
+    throw unsupported();
+  return p.val % align == 0 ? &b : nullptr;
+}
+
+ConcreteVal
+Interpreter::load(const Block &b, uint64_t offset, const Type &ty) const {
+  auto *bytes = &b.bytes[offset];
+
+  if (ty.isPtrType()) {
+    auto &first = bytes[0];
+    for (unsigned i = 0; i < ptr_bytes; ++i) {
+      if (bytes[i].poison)
+        return mkPtr(0, 0, true);
+      // type punning an integer into a pointer
+      if (bytes[i].ptr_idx != i + 1 || bytes[i].bid != first.bid ||
+          bytes[i].offset != first.offset)
+        throw unsupported();
+    }
+    return mkPtr(first.bid, first.offset);
+  }
+
+  unsigned bits = int_bits(ty);
+  // the layout of the padding of big-endian integers isn't simulated
+  if (!little_endian && bits % 8)
+    throw unsupported();
+
+  uint64_t val = 0;
+  bool poison = false;
+  for (unsigned i = 0, e = (bits + 7) / 8; i < e; ++i) {
+    if (bytes[i].ptr_idx)
+      throw unsupported();
+    poison |= bytes[i].poison;
+    val |= (uint64_t)bytes[i].val << (8 * (little_endian ? i : e - 1 - i));
+  }
+  return { val & mask(bits), bits, poison };
+}
+
+void Interpreter::store(Block &b, uint64_t offset, const ConcreteVal &v,
+                        unsigned bytes) {
+  for (unsigned i = 0; i < bytes; ++i) {
+    auto &byte = b.bytes[offset + i];
+    byte = Byte();
+    byte.poison = v.poison;
+    if (v.poison)
+      continue;
+
+    if (v.ptr) {
+      byte.ptr_idx = i + 1;
+      byte.bid = v.bid;
+      byte.offset = v.val;
+    } else {
+      if (!little_endian && v.bits % 8)
+        throw unsupported();
+      byte.val = (uint8_t)(v.val >> (8 * (little_endian ? i : bytes - 1 - i)));
+    }
+  }
+}
+
+const ConcreteVal* Interpreter::at(const Value &v) const {
+  auto I = vals.find(&v);
+  return I != vals.end() ? &I->second : nullptr;
+}
+
+Interpreter::Status
+Interpreter::step(const Instr &i, const BasicBlock *&next) {
+  if (auto *bop = dynamic_cast<const BinOp*>(&i)) {
+    auto a = get(bop->getLhs()), b = get(bop->getRhs());
+    unsigned w = int_bits(i.getType());
+    uint64_t m = mask(w), x = a.val, y = b.val, r = 0;
+    int64_t sx = sext(x, w), sy = sext(y, w);
+    auto flags = bop->getFlags();
+    bool np = true;
+
+    switch (bop->getOp()) {
+    case BinOp::Add:
+      r = x + y;
+      if (flags & BinOp::NSW)
+        np &= fits_signed((__int128)sx + sy, w);
+      if (flags & BinOp::NUW)
+        np &= (unsigned __int128)x + y <= m;
+      break;
+    case BinOp::Sub:
+      r = x - y;
+      if (flags & BinOp::NSW)
+        np &= fits_signed((__int128)sx - sy, w);
+      if (flags & BinOp::NUW)
+        np &= x >= y;
+      break;
+    case BinOp::Mul:
+      r = x * y;
+      if (flags & BinOp::NSW)
+        np &= fits_signed((__int128)sx * sy, w);
+      if (flags & BinOp::NUW)
+        np &= (unsigned __int128)x * y <= m;
+      break;
+    case BinOp::SDiv:
+    case BinOp::UDiv:
+    case BinOp::SRem:
+    case BinOp::URem: {
+      bool sign = bop->getOp() == BinOp::SDiv || bop->getOp() == BinOp::SRem;
+      if (b.poison || y == 0 ||
+          (sign && y == m && (a.poison || x == int_smin(w))))
+        return UB;
+
+      switch (bop->getOp()) {
+      case BinOp::SDiv:
+        r = sx / sy;
+        if (flags & BinOp::Exact)
+          np = sx % sy == 0;
+        break;
+      case BinOp::UDiv:
+        r = x / y;
+        if (flags & BinOp::Exact)
+          np = x % y == 0;
+        break;
+      case BinOp::SRem:
+        r = sx % sy;
+        break;
+      default:
+        r = x % y;
+        break;
+      }
+      // a poison divisor is UB, so only the dividend can make it poison
+      set(i, { r & m, w, a.poison || !np });
+      return Done;
+    }
+    case BinOp::Shl:
+      np = y < w;
+      if (np) {
+        r = (x << y) & m;
+        if (flags & BinOp::NSW)
+          np &= (sext(r, w) >> y) == sx;
+        if (flags & BinOp::NUW)
+          np &= (r >> y) == x;
+      }
+      break;
+    case BinOp::AShr:
+    case BinOp::LShr:
+      np = y < w;
+      if (np) {
+        r = bop->getOp() == BinOp::AShr ? (uint64_t)(sx >> y) : x >> y;
+        if (flags & BinOp::Exact)
+          np &= (x & mask(y)) == 0;
+      }
+      break;
+    case BinOp::SAdd_Sat:
+      r = clamp_signed((__int128)sx + sy, w);
+      break;
+    case BinOp::UAdd_Sat:
+      r = min<unsigned __int128>((unsigned __int128)x + y, m);
+      break;
+    case BinOp::SSub_Sat:
+      r = clamp_signed((__int128)sx - sy, w);
+      break;
+    case BinOp::USub_Sat:
+      r = x >= y ? x - y : 0;
+      break;
+    case BinOp::SShl_Sat:
+      np = y < w;
+      if (np) {
+        r = (x << y) & m;
+        if ((sext(r, w) >> y) != sx)
+          r = sx < 0 ? int_smin(w) : int_smax(w);
+      }
+      break;
+    case BinOp::UShl_Sat:
+      np = y < w;
+      if (np) {
+        r = (x << y) & m;
+        if ((r >> y) != x)
+          r = m;
+      }
+      break;
+    case BinOp::And:
+      r = x & y;
+      break;
+    case BinOp::Or:
+      r = x | y;
+      break;
+    case BinOp::Xor:
+      r = x ^ y;
+      break;
+    case BinOp::Cttz:
+      r = x == 0 ? w : countr_zero(x);
+      np = y == 0 || x != 0;
+      break;
+    case BinOp::Ctlz:
+      r = x == 0 ? w : countl_zero(x) - (64 - w);
+      np = y == 0 || x != 0;
+      break;
+    case BinOp::UMin:
+      r = min(x, y);
+      break;
+    case BinOp::UMax:
+      r = max(x, y);
+      break;
+    case BinOp::SMin:
+      r = sx < sy ? x : y;
+      break;
+    case BinOp::SMax:
+      r = sx > sy ? x : y;
+      break;
+    case BinOp::Abs:
+      r = sx < 0 ? -x : x;
+      np = y == 0 || x != int_smin(w);
+      break;
+    default:
+      throw unsupported();
+    }
+    set(i, { r & m, w, a.poison || b.poison || !np });
+    return Done;
+  }
+
+  if (auto *uop = dynamic_cast<const UnaryOp*>(&i)) {
+    auto a = get(uop->getValue());
+    unsigned w = int_bits(i.getType());
+    uint64_t x = a.val, r = 0;
+
+    switch (uop->getOp()) {
+    case UnaryOp::Copy:
+      r = x;
+      break;
+    case UnaryOp::BitReverse:
+      for (unsigned j = 0; j < w; ++j) {
+        r |= ((x >> j) & 1) << (w - 1 - j);
+      }
+      break;
+    case UnaryOp::BSwap:
+      for (unsigned j = 0; j < w; j += 8) {
+        r |= ((x >> j) & 0xff) << (w - 8 - j);
+      }
+      break;
+    case UnaryOp::Ctpop:
+      r = popcount(x);
+      break;
+    default:
+      throw unsupported();
+    }
+    set(i, { r & mask(w), w, a.poison });
+    return Done;
+  }
+
+  if (auto *top = dynamic_cast<const TernaryOp*>(&i)) {
+    auto ops = top->operands();
+    auto a = get(*ops[0]), b = get(*ops[1]), c = get(*ops[2]);
+    unsigned w = int_bits(i.getType());
+    uint64_t sh = c.val % w, r;
+
+    switch (top->getOp()) {
+    case TernaryOp::FShl:
+      r = sh == 0 ? a.val : (a.val << sh) | (b.val >> (w - sh));
+      break;
+    case TernaryOp::FShr:
+      r = sh == 0 ? b.val : (a.val << (w - sh)) | (b.val >> sh);
+      break;
+    default:
+      throw unsupported();
+    }
+    set(i, { r & mask(w), w, a.poison || b.poison || c.poison });
+    return Done;
+  }
+
+  if (auto *conv = dynamic_cast<const ConversionOp*>(&i)) {
+    auto a = get(conv->getValue());
+    unsigned w = int_bits(i.getType());
+    uint64_t r;
+
+    switch (conv->getOp()) {
+    case ConversionOp::SExt:
+      r = sext(a.val, a.bits);
+      break;
+    case ConversionOp::ZExt:
+    case ConversionOp::Trunc:
+    case ConversionOp::BitCast:
+      r = a.val;
+      break;
+    default:
+      throw unsupported();
+    }
+    set(i, { r & mask(w), w, a.poison });
+    return Done;
+  }
+
+  if (auto *sel = dynamic_cast<const Select*>(&i)) {
+    auto c = get(*sel->getCond());
+    if (!i.getType().isPtrType())
+      (void)int_bits(i.getType());
+    auto v = get(*(c.val ? sel->getTrueValue() : sel->getFalseValue()));
+    v.poison |= c.poison;
+    set(i, v);
+    return Done;
+  }
+
+  if (auto *icmp = dynamic_cast<const ICmp*>(&i)) {
+    auto ops = icmp->operands();
+    auto a = get(*ops[0]), b = get(*ops[1]);
+
+    if (icmp->isPtrCmp()) {
+      // only comparisons of addresses are simulated
+      if (icmp->getPtrCmpMode() != ICmp::INTEGRAL)
+        throw unsupported();
+
+      auto cond = icmp->getCond();
+      bool eq = cond == ICmp::EQ || cond == ICmp::NE;
+      auto in_bounds = [&](const ConcreteVal &p) {
+        return p.bid != 0 && p.val <= blocks[p.bid].bytes.size();
+      };
+
+      // addresses of different blocks are unknown, except that they are
+      // never null
+      if (!a.poison && !b.poison && a.bid != b.bid) {
+        bool null_a = a.bid == 0 && a.val == 0;
+        bool null_b = b.bid == 0 && b.val == 0;
+        if (!eq || !((null_a && in_bounds(b)) || (null_b && in_bounds(a))))
+          throw unsupported();
+        set(i, { cond == ICmp::NE, 1 });
+        return Done;
+      }
+      // within a block, only the offsets of in-bounds pointers are ordered
+      if (!eq && !a.poison && !b.poison &&
+          (cond == ICmp::SLE || cond == ICmp::SLT || cond == ICmp::SGE ||
+           cond == ICmp::SGT || !in_bounds(a) || !in_bounds(b)))
+        throw unsupported();
+    }
+    int64_t sa = sext(a.val, a.bits), sb = sext(b.val, b.bits);
+    bool r;
+
+    switch (icmp->getCond()) {
+    case ICmp::EQ:  r = a.val == b.val; break;
+    case ICmp::NE:  r = a.val != b.val; break;
+    case ICmp::SLE: r = sa <= sb; break;
+    case ICmp::SLT: r = sa < sb; break;
+    case ICmp::SGE: r = sa >= sb; break;
+    case ICmp::SGT: r = sa > sb; break;
+    case ICmp::ULE: r = a.val <= b.val; break;
+    case ICmp::ULT: r = a.val < b.val; break;
+    case ICmp::UGE: r = a.val >= b.val; break;
+    case ICmp::UGT: r = a.val > b.val; break;
+    default:
+      throw unsupported();
+    }
+    set(i, { r, 1, a.poison || b.poison });
+    return Done;
+  }
+
+  if (dynamic_cast<const Freeze*>(&i)) {
+    auto a = get(*i.operands()[0]);
+    // freezing poison yields an arbitrary value
+    if (a.poison)
+      throw unsupported();
+    set(i, a);
+    return Done;
+  }
+
+  if (auto *br = dynamic_cast<const Branch*>(&i)) {
+    auto ops = br->operands();
+    if (ops.empty()) {
+      next = &br->getTrue();
+      return Done;
+    }
+    auto c = get(*ops[0]);
+    if (c.poison)
+      return UB;
+    next = c.val ? &br->getTrue() : br->getFalse();
+    return Done;
+  }
+
+  if (auto *sw = dynamic_cast<const Switch*>(&i)) {
+    auto v = get(*sw->operands()[0]);
+    if (v.poison)
+      return UB;
+    next = sw->getDefault();
+    for (unsigned j = 0, e = sw->getNumTargets(); j != e; ++j) {
+      auto &[target, bb] = sw->getTarget(j);
+      if (get(*target).val == v.val) {
+        next = bb;
+        break;
+      }
+    }
+    return Done;
+  }
+
+  if (dynamic_cast<const Return*>(&i)) {
+    auto &attrs = f.getFnAttrs();
+    if (f.getReturnedInput())
+      throw unsupported();
+
+    if (auto *val = i.operands()[0]; !val->isVoid()) {
+      retval = get(*val);
+      if (retval.poison && attrs.poisonImpliesUB())
+        return UB;
+    }
+    if (attrs.has(FnAttrs::NoReturn))
+      return UB;
+    returned = true;
+    return Done;
+  }
+
+  if (auto *assume = dynamic_cast<const Assume*>(&i)) {
+    auto kind = assume->getKind();
+    if (kind != Assume::AndNonPoison && kind != Assume::IfNonPoison)
+      throw unsupported();
+
+    auto c = get(*i.operands()[0]);
+    if (c.poison ? kind == Assume::AndNonPoison : c.val == 0)
+      return UB;
+    return Done;
+  }
+
+  if (auto *alloc = dynamic_cast<const Alloc*>(&i)) {
+    auto sz = get(alloc->getSize());
+    if (sz.poison)
+      return UB;
+
+    unsigned __int128 size = sz.val;
+    if (auto *mul = alloc->getMul()) {
+      auto m = get(*mul);
+      if (m.poison)
+        return UB;
+      size *= m.val;
+    }
+    if (size > max_alloc_size)
+      throw unsupported();
+
+    blocks.push_back({ vector<Byte>((size_t)size), max(alloc->getAlign(), 1u),
+                       !alloc->initDead() });
+    set(i, mkPtr(blocks.size() - 1, 0));
+    return Done;
+  }
+
+  if (dynamic_cast<const StartLifetime*>(&i)) {
+    auto p = get(*i.operands()[0]);
+    if (p.poison || p.bid == 0)
+      return UB;
+    blocks[p.bid].alive = true;
+    return Done;
+  }
+
+  if (auto *fr = dynamic_cast<const Free*>(&i)) {
+    auto p = get(*i.operands()[0]);
+    if (p.poison)
+      return UB;
+    if (p.bid == 0 && p.val == 0)
+      return Done;
+    // only heap blocks can be freed, but all blocks here are allocas
+    if (fr->isHeapOnly())
+      return UB;
+    if (p.bid != 0)
+      blocks[p.bid].alive = false;
+    return Done;
+  }
+
+  if (auto *gep = dynamic_cast<const GEP*>(&i)) {
+    if (!i.getType().isPtrType())
+      throw unsupported();
+
+    auto p = get(gep->getPtr());
+    bool inbounds = gep->isInBounds();
+    uint64_t size = p.bid ? blocks[p.bid].bytes.size() : 0;
+    auto in_block = [&](int64_t off) {
+      return !inbounds || (off >= 0 && (uint64_t)off <= size);
+    };
+
+    bool np = !p.poison && in_block(p.val);
+    int64_t off = p.val;
+    for (auto &[sz, idx] : gep->getIdxs()) {
+      auto v = get(*idx);
+      __int128 n = off + (__int128)sz * sext(v.val, v.bits);
+      if (!fits_signed(n, ptr_bytes * 8))
+        throw unsupported();
+      off = (int64_t)n;
+      np &= !v.poison && in_block(off);
+    }
+    set(i, mkPtr(p.bid, off, !np));
+    return Done;
+  }
+
+  if (auto *load = dynamic_cast<const Load*>(&i)) {
+    auto &ty = i.getType();
+    unsigned bytes = ty.isPtrType() ? ptr_bytes : (int_bits(ty) + 7) / 8;
+    auto p = get(load->getPtr());
+    auto *b = deref(p, bytes, load->getAlign());
+    if (!b)
+      return UB;
+    set(i, this->load(*b, p.val, ty));
+    return Done;
+  }
+
+  if (auto *st = dynamic_cast<const Store*>(&i)) {
+    auto &ty = st->getValue().getType();
+    unsigned bytes = ty.isPtrType() ? ptr_bytes : (int_bits(ty) + 7) / 8;
+    auto v = get(st->getValue());
+    auto p = get(st->getPtr());
+    auto *b = deref(p, bytes, st->getAlign());
+    if (!b)
+      return UB;
+    store(*b, p.val, v, bytes);
+    return Done;
+  }
+
+  throw unsupported();
+}
+
+Interpreter::Status
+Interpreter::run(const unordered_map<string, ConcreteVal> &inputs,
+                 unsigned max_steps) {
+  this->inputs = &inputs;
+  vals.clear();
+  trace.clear();
+  blocks.assign(1, { {}, 1, false });
+  retval = {};
+  returned = false;
+
+  try {
+    const BasicBlock *bb = &f.getFirstBB(), *pred = nullptr;
+    while (bb && !returned) {
+      // jumps past the unrolling bound
+      if (bb == &f.getSinkBB())
+        return Unsupported;
+
+      // phis read the values at the end of the predecessor
+      vector<pair<const Instr*, ConcreteVal>> phis;
+      const BasicBlock *next = nullptr;
+
+      for (auto &i : bb->instrs()) {
+        if (max_steps-- == 0)
+          return Unsupported;
+
+        if (auto *phi = dynamic_cast<const Phi*>(&i)) {
+          auto &in = phi->getValues();
+          auto I = find_if(in.begin(), in.end(), [&](auto &p) {
+            return pred && p.second == pred->getName();
+          });
+          if (I == in.end())
+            throw unsupported();
+          phis.emplace_back(&i, get(*I->first));
+          continue;
+        }
+
+        for (auto &[phi, v] : phis) {
+          set(*phi, v);
+        }
+        phis.clear();
+
+        if (step(i, next) == UB)
+          return UB;
+      }
+
+      for (auto &[phi, v] : phis) {
+        set(*phi, v);
+      }
+      pred = bb;
+      bb = next;
+    }
+  } catch (const unsupported&) {
+    return Unsupported;
+  }
+  return Done;
+}
+
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+// Copyright (c) 2018-present The Alive2 Authors.
+// Distributed under the MIT license that can be found in the LICENSE file.
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace IR {
+class BasicBlock;
+class Function;
+class Instr;
+class Type;
+class Value;
+}
+
+namespace tools {
+
+// An integer of up to 64 bits (zero-extended), a pointer, or poison.
+// Pointers are a block id (0 is null) plus an offset stored in val.
+struct ConcreteVal {
+  uint64_t val = 0;
+  unsigned bits = 0;
+  bool poison = false;
+  bool ptr = false;
+  unsigned bid = 0;
+
+  bool operator==(const ConcreteVal &rhs) const = default;
+  friend std::ostream& operator<<(std::ostream &os, const ConcreteVal &v);
+};
+
+
+// Executes a function on concrete inputs. Only a subset of the IR is
+// supported (integers of up to 64 bits, pointers to allocas); if the
+// execution reaches anything else, including a non-deterministic choice, the
+// run is inconclusive.
+class Interpreter {
+public:
+  enum Status { Done, UB, Unsupported };
+
+private:
+  // pointers are stored as a sequence of fragments of the pointer value
+  struct Byte {
+    uint8_t val = 0;
+    bool poison = true;
+    uint8_t ptr_idx = 0; // 1-based index of the fragment; 0 if an integer
+    unsigned bid = 0;
+    uint64_t offset = 0;
+  };
+
+  struct Block {
+    std::vector<Byte> bytes;
+    unsigned align;
+    bool alive;
+  };
+
+  const IR::Function &f;
+  // size of pointers in memory and byte order, per the data layout
+  unsigned ptr_bytes;
+  bool little_endian;
+  // block 0 is null
+  std::vector<Block> blocks;
+  std::unordered_map<const IR::Value*, ConcreteVal> vals;
+  std::vector<std::pair<const IR::Value*, ConcreteVal>> trace;
+  const std::unordered_map<std::string, ConcreteVal> *inputs = nullptr;
+  ConcreteVal retval;
+  bool returned = false;
+  bool record_trace;
+
+  ConcreteVal mkPtr(unsigned bid, uint64_t offset, bool poison = false) const;
+  ConcreteVal get(const IR::Value &v) const;
+  void set(const IR::Instr &i, ConcreteVal v);
+  Block* deref(const ConcreteVal &p, uint64_t bytes, unsigned align);
+  ConcreteVal load(const Block &b, uint64_t offset, const IR::Type &ty) const;
+  void store(Block &b, uint64_t offset, const ConcreteVal &v, unsigned bytes);
+  Status step(const IR::Instr &i, const IR::BasicBlock *&next);
+
+public:
+  Interpreter(const IR::Function &f, bool record_trace = true);
+
+  // inputs are indexed by name
+  Status run(const std::unordered_map<std::string, ConcreteVal> &inputs,
+             unsigned max_steps = 100000);
+
+  // value of v in the last run, if it was executed
+  const ConcreteVal* at(const IR::Value &v) const;
+
+  // executed instructions, in order (if record_trace is set)
+  auto& getValues() const { return trace; }
+
+  bool hasReturned() const { return returned; }
+  auto& getReturnVal() const { return retval; }
+};
+
+}
@@ -2,23 +2,30 @@
 // Distributed under the MIT license that can be found in the LICENSE file.
 
 #include "tools/transform.h"
+#include "ir/constant.h"
 #include "ir/globals.h"
 #include "ir/state.h"
 #include "smt/expr.h"
 #include "smt/smt.h"
 #include "smt/solver.h"
+#include "tools/interpreter.h"
 #include "util/config.h"
 #include "util/dataflow.h"
 #include "util/errors.h"
 #include "util/stopwatch.h"
 #include "util/symexec.h"
+#include "util/trace.h"
 #include <algorithm>
+#include <climits>
 #include <iostream>
 #include <map>
 #include <numeric>
+#include <optional>
+#include <random>
 #include <set>
 #include <sstream>
 #include <unordered_map>
+#include <unordered_set>
 
 using namespace IR;
 using namespace smt;
@@ -352,12 +359,73 @@ static expr encode_undef_refinement(const Type &type, const State::ValTy &a,
                                           expr(b.first.value), subst(b));
 }
 
+// Pairs the undef vars of each src instruction with those of the tgt
+// instruction with the same name and text, so that src can be made to pick
+// the same undef values as tgt. Instantiating src's quantified vars is
+// always sound, so a wrong alignment only makes the check fail (and be
+// redone without it).
+static vector<pair<expr, expr>>
+align_undef_vars(const State &src_state, const State &tgt_state) {
+  auto print = [](const Value &v) {
+    ostringstream os;
+    v.print(os);
+    return std::move(os).str();
+  };
+
+  unordered_map<string, pair<const Value*, const State::ValTy*>> tgt_vals;
+  for (auto &[var, val] : tgt_state.getValues()) {
+    if (dynamic_cast<const Instr*>(var) && !val.second.empty())
+      tgt_vals.emplace(var->getName(), make_pair(var, &val));
+  }
+
+  auto is_bv = [](const expr &a, const expr &b) {
+    return a.isBV() && b.isBV() && a.bits() == b.bits();
+  };
+
+  vector<pair<expr, expr>> repls;
+  set<expr> seen;
+  for (auto &[var, val] : src_state.getValues()) {
+    auto I = tgt_vals.find(var->getName());
+    if (val.second.empty() || I == tgt_vals.end() ||
+        val.second.size() != I->second.second->second.size() ||
+        print(*var) != print(*I->second.first))
+      continue;
+
+    for (auto II = val.second.begin(), JJ = I->second.second->second.begin(),
+           E = val.second.end(); II != E; ++II, ++JJ) {
+      if (!II->eq(*JJ) && is_bv(*II, *JJ) && seen.emplace(*II).second)
+        repls.emplace_back(*II, *JJ);
+    }
+  }
+  return repls;
+}
+
+// Records the values of the integer inputs in a counterexample. These don't
+// depend on the width of pointer offsets.
+static void get_input_model(const State &src_state, const Model &m,
+                            vector<pair<expr, expr>> &inputs) {
+  inputs.clear();
+  auto &qvars = src_state.getQuantVars();
+  for (auto &[var, val] : src_state.getValues()) {
+    if (!dynamic_cast<const Input*>(var) || !var->getType().isIntType())
+      continue;
+    for (auto *e : { &val.first.value, &val.first.non_poison }) {
+      for (auto &v : e->vars()) {
+        if (!qvars.count(v) && !val.second.count(v))
+          inputs.emplace_back(v, m[v]);
+      }
+    }
+  }
+}
+
 static void
 check_refinement(Errors &errs, const Transform &t, const State &src_state,
                  const State &tgt_state, const Value *var, const Type &type,
                  const expr &dom_a, const expr &fndom_a, const State::ValTy &ap,
                  const expr &dom_b, const expr &fndom_b, const State::ValTy &bp,
-                 bool check_each_var) {
+                 bool check_each_var,
+                 const vector<pair<expr, expr>> &lockstep_repls,
+                 vector<pair<expr, expr>> *cex_inputs = nullptr) {
   if (src_state.sinkDomain().isTrue()) {
     errs.add("The source program doesn't reach a return instruction.\n"
              "Consider increasing the unroll factor if it has loops", false);
@@ -399,7 +467,29 @@ check_refinement(Errors &errs, const Transform &t, const State &src_state,
   expr axioms_expr = axioms();
   pre_tgt &= !sink_tgt;
 
-  if (check_expr(axioms_expr && (pre_src && pre_tgt)).isUnsat()) {
+  // In incremental mode, the axioms (and the precondition, if possible) are
+  // asserted only once and each check below runs in its own solver scope.
+  // The incremental solver doesn't run our tactics, so if it gives up
+  // (e.g., incomplete quantifiers) we retry the query from scratch.
+  expr shared = axioms_expr;
+  optional<Solver> inc_solver;
+  if (config::incremental_refinement) {
+    inc_solver.emplace(true);
+    inc_solver->add(shared);
+  }
+
+  auto solve = [&](const expr &e) -> Result {
+    if (inc_solver) {
+      SolverPush push(*inc_solver);
+      inc_solver->add(e);
+      auto res = inc_solver->check();
+      if (!res.isError())
+        return res;
+    }
+    return check_expr(shared && e);
+  };
+
+  if (solve(pre_src && pre_tgt).isUnsat()) {
     errs.add("Precondition is always false", false);
     return;
   }
@@ -418,7 +508,21 @@ check_refinement(Errors &errs, const Transform &t, const State &src_state,
   expr pre = pre_src_exists && pre_tgt && src_state.getFnPre();
   pre_src_forall &= tgt_state.getFnPre();
 
-  auto mk_fml = [&](expr &&refines) -> expr {
+  // pre can be moved out of the quantifier if it doesn't mention any of the
+  // quantified variables
+  bool shared_pre = false;
+  if (inc_solver) {
+    auto vars_pre = pre.vars();
+    shared_pre = none_of(qvars.begin(), qvars.end(),
+                         [&](auto &v) { return vars_pre.count(v); });
+    if (shared_pre) {
+      inc_solver->add(pre);
+      shared &= pre;
+    }
+  }
+
+  using Repls = vector<pair<expr, expr>>;
+  auto mk_fml = [&](expr &&refines, const Repls *lockstep = nullptr) -> expr {
     // from the check above we already know that
     // \exists v,v' . pre_tgt(v') && pre_src(v) is SAT (or timeout)
     // so \forall v . pre_tgt && (!pre_src(v) || refines) simplifies to:
@@ -428,13 +532,36 @@ check_refinement(Errors &errs, const Transform &t, const State &src_state,
     if (refines.isFalse())
       return move(refines);
 
-    return axioms_expr &&
-            preprocess(t, qvars, uvars, pre && pre_src_forall.implies(refines));
+    expr fml = pre_src_forall.implies(refines);
+    if (!shared_pre)
+      fml = pre && fml;
+
+    if (lockstep) {
+      auto qvars_left = qvars;
+      for (auto &[src, tgt] : *lockstep) {
+        qvars_left.erase(src);
+      }
+      return preprocess(t, qvars_left, uvars, fml.subst(*lockstep));
+    }
+    return preprocess(t, qvars, uvars, move(fml));
   };
 
   auto check = [&](expr &&e, auto &&printer, const char *msg) -> bool{
+    TraceSpan span("refinement check",
+                   var ? msg + (" for " + var->getName()) : string(msg));
+    // try first with src's undef vars instantiated with tgt's
+    Repls lockstep;
+    for (auto &p : lockstep_repls) {
+      if (qvars.count(p.first) && !qvars.count(p.second))
+        lockstep.emplace_back(p);
+    }
+    if (!lockstep.empty() && solve(mk_fml(expr(e), &lockstep)).isUnsat())
+      return true;
+
     e = mk_fml(move(e));
-    auto res = check_expr(e);
+    auto res = solve(e);
+    if (res.isSat() && cex_inputs)
+      get_input_model(src_state, res.getModel(), *cex_inputs);
     if (!res.isUnsat() &&
         !error(errs, src_state, tgt_state, res, var, msg, check_each_var,
                printer))
@@ -488,8 +615,10 @@ check_refinement(Errors &errs, const Transform &t, const State &src_state,
   // 6. Check memory
   auto src_mem = src_state.returnMemory();
   auto tgt_mem = tgt_state.returnMemory();
+  vector<pair<unsigned, expr>> mem_blocks;
   auto [memory_cnstr0, ptr_refinement0, mem_undef]
-    = src_mem.refined(tgt_mem, false);
+    = src_mem.refined(tgt_mem, false, nullptr, nullptr,
+                      config::split_memory ? &mem_blocks : nullptr);
   auto &ptr_refinement = ptr_refinement0;
   qvars.insert(mem_undef.begin(), mem_undef.end());
 
@@ -501,13 +630,182 @@ check_refinement(Errors &errs, const Transform &t, const State &src_state,
       << "\nTarget value: " << Byte(tgt_mem, m[tgt_mem.load(p, undef)()]);
   };
 
-  CHECK(dom && !(memory_cnstr0.isTrue() ? memory_cnstr0
-                                        : value_cnstr && memory_cnstr0),
-        print_ptr_load, "Mismatch in memory");
+  // Check each block in a separate query; the lockstep attempt is skipped.
+  // This is equivalent to the single query, since #idx_refinement is bound
+  // outside the quantifier over src's undef vars and selects a single block.
+  if (mem_blocks.size() > 1) {
+    TraceSpan span("refinement check", "Mismatch in memory (split)");
+    vector<expr> fmls;
+    for (auto &[bid, block] : mem_blocks) {
+      fmls.emplace_back(shared && mk_fml(dom && !(value_cnstr && block)));
+    }
+    auto [idx, res] = check_exprs(fmls, config::split_memory);
+    if (res.isSat() && cex_inputs)
+      get_input_model(src_state, res.getModel(), *cex_inputs);
+    if (idx != fmls.size() &&
+        !error(errs, src_state, tgt_state, res, var, "Mismatch in memory",
+               check_each_var, print_ptr_load))
+      return;
+  } else {
+    CHECK(dom && !(memory_cnstr0.isTrue() ? memory_cnstr0
+                                          : value_cnstr && memory_cnstr0),
+          print_ptr_load, "Mismatch in memory");
+  }
 
 #undef CHECK
 }
 
+// Picks an input value; the first trials try each boundary value on all
+// inputs, and the remaining ones mix boundary and random values.
+static uint64_t pick_concrete_input(mt19937_64 &rng, unsigned bits,
+                                    unsigned trial) {
+  uint64_t mask = bits >= 64 ? ~0ull : (1ull << bits) - 1;
+  uint64_t smin = 1ull << (bits - 1);
+  switch (trial < 5 ? trial : rng() % 8) {
+  case 0:  return 0;
+  case 1:  return 1;
+  case 2:  return mask;
+  case 3:  return smin;
+  case 4:  return mask >> 1;
+  case 5:  return (1ull << (rng() % bits)) & mask;
+  default: return rng() & mask;
+  }
+}
+
+// Executes src and tgt on concrete inputs before encoding them in SMT.
+// Returns true if a counterexample was found and added to errs.
+static bool falsify_concretely(const Transform &t, bool check_each_var,
+                               Errors &errs) {
+  if (t.precondition)
+    return false;
+
+  vector<const Value*> inputs;
+  for (auto &v : t.src.getInputs()) {
+    inputs.emplace_back(&v);
+  }
+  for (auto &v : t.src.getConstants()) {
+    if (dynamic_cast<const ConstantInput*>(&v))
+      inputs.emplace_back(&v);
+  }
+  for (auto *in : inputs) {
+    if (!in->getType().isIntType() || in->getType().bits() > 64)
+      return false;
+  }
+
+  unordered_map<string, const Instr*> tgt_instrs;
+  for (auto &i : t.tgt.instrs()) {
+    tgt_instrs.emplace(i.getName(), &i);
+  }
+
+  Interpreter src(t.src), tgt(t.tgt);
+  unordered_map<string, ConcreteVal> vals;
+  mt19937_64 rng(0);
+
+  // Report the failure that the SMT checks would find first: variables in
+  // order, then the return value; for each, UB, then poison, then value.
+  enum Kind { Ok, UB, Poison, Mismatch };
+  pair<unsigned, unsigned> best(UINT_MAX, Ok);
+  string best_msg;
+
+  for (unsigned trial = 0; trial < config::concrete_tests; ++trial) {
+    for (auto *in : inputs) {
+      auto *input = dynamic_cast<const Input*>(in);
+      bool poison = trial >= 5 && input && !config::disable_poison_input &&
+                    !input->getAttributes().poisonImpliesUB() &&
+                    rng() % 8 == 0;
+      unsigned bits = in->getType().bits();
+      vals[in->getName()]
+        = { pick_concrete_input(rng, bits, trial), bits, poison };
+    }
+
+    // src must be well defined for the input to be interesting
+    if (src.run(vals) != Interpreter::Done)
+      continue;
+    auto tgt_status = tgt.run(vals);
+    if (tgt_status == Interpreter::Unsupported)
+      continue;
+
+    auto refines = [](const ConcreteVal &sv, const ConcreteVal &tv) {
+      if (sv.poison)
+        return Ok;
+      if (tv.poison)
+        return Poison;
+      // block ids of src and tgt are unrelated
+      if (sv.ptr || tv.ptr)
+        return Ok;
+      return sv.val == tv.val ? Ok : Mismatch;
+    };
+
+    unsigned idx = 0;
+    Kind kind = Ok;
+    const Value *var = nullptr;
+    ConcreteVal a, b;
+
+    if (check_each_var) {
+      for (auto &i : t.src.instrs()) {
+        auto &name = i.getName();
+        auto I = tgt_instrs.find(name);
+        if (name[0] != '%' || I == tgt_instrs.end())
+          continue;
+        auto *sv = src.at(i), *tv = tgt.at(*I->second);
+        if (sv && tv && sv->bits == tv->bits &&
+            (kind = refines(*sv, *tv)) != Ok) {
+          var = &i;
+          a = *sv;
+          b = *tv;
+          break;
+        }
+        ++idx;
+      }
+    }
+
+    if (kind == Ok) {
+      idx = UINT_MAX - 1;
+      if (tgt_status == Interpreter::UB) {
+        kind = UB;
+      } else if (src.hasReturned() && tgt.hasReturned()) {
+        a = src.getReturnVal();
+        b = tgt.getReturnVal();
+        kind = refines(a, b);
+      }
+    }
+
+    if (kind == Ok || make_pair(idx, (unsigned)kind) >= best)
+      continue;
+    best = { idx, kind };
+
+    stringstream s;
+    s << (kind == UB     ? "Source is more defined than target" :
+          kind == Poison ? "Target is more poisonous than source" :
+                           "Value mismatch");
+    if (var)
+      s << " for " << *var;
+    s << "\n\nExample:\n";
+    for (auto *in : inputs) {
+      s << *in << " = " << vals[in->getName()] << '\n';
+    }
+
+    for (auto *st : { &src, &tgt }) {
+      s << (st == &src ? "\nSource:\n" : "\nTarget:\n");
+      for (auto &[v, val] : st->getValues()) {
+        if (var && v->getName() == var->getName())
+          break;
+        if (v->getName()[0] == '%')
+          s << *v << " = " << val << '\n';
+      }
+    }
+
+    if (kind != UB)
+      s << "Source value: " << a << "\nTarget value: " << b << '\n';
+    best_msg = s.str();
+  }
+
+  if (best_msg.empty())
+    return false;
+  errs.add(move(best_msg), true);
+  return true;
+}
+
 static bool has_nullptr(const Value *v) {
   if (dynamic_cast<const NullPointerValue*>(v) ||
       (dynamic_cast<const UndefValue*>(v) && hasPtr(v->getType())))
@@ -709,7 +1007,10 @@ static void initBitsProgramPointer(Transform &t) {
   assert(bits_program_pointer == t.tgt.bitsPointers());
 }
 
-static void calculateAndInitConstants(Transform &t) {
+// Returns true if the offsets were narrowed to offset_bits_limit.
+static bool calculateAndInitConstants(Transform &t,
+                                      unsigned offset_bits_limit = 0) {
+  TraceSpan span("calculateAndInitConstants");
   if (!bits_program_pointer)
     initBitsProgramPointer(t);
 
@@ -753,6 +1054,8 @@ static void calculateAndInitConstants(Transform &t) {
   num_locals_src = 0;
   num_locals_tgt = 0;
   uint64_t max_gep_src = 0, max_gep_tgt = 0;
+  // as above, but only with the constant GEP indices
+  uint64_t const_gep_src = 0, const_gep_tgt = 0;
   uint64_t max_alloc_size = 0;
   uint64_t max_aligned_size = 0;
   uint64_t max_access_size = 0;
@@ -781,6 +1084,7 @@ static void calculateAndInitConstants(Transform &t) {
   for (auto fn : { &t.src, &t.tgt }) {
     unsigned &cur_num_locals = fn == &t.src ? num_locals_src : num_locals_tgt;
     uint64_t &cur_max_gep    = fn == &t.src ? max_gep_src : max_gep_tgt;
+    uint64_t &cur_const_gep  = fn == &t.src ? const_gep_src : const_gep_tgt;
 
     for (auto &v : fn->getInputs()) {
       auto *i = dynamic_cast<const Input *>(&v);
@@ -842,6 +1146,16 @@ static void calculateAndInitConstants(Transform &t) {
         cur_max_gep      = add_saturate(cur_max_gep, mi->getMaxGEPOffset());
         has_free        |= mi->canFree();
 
+        if (auto gep = dynamic_cast<const GEP*>(&i)) {
+          for (auto &[mul, idx] : gep->getIdxs()) {
+            auto c = dynamic_cast<const IntConst*>(idx);
+            if (auto n = c ? c->getInt() : nullptr)
+              cur_const_gep
+                = add_saturate(cur_const_gep,
+                               mul_saturate(mul, *n < 0 ? -(uint64_t)*n : *n));
+          }
+        }
+
         auto info = mi->getByteAccessInfo();
         has_ptr_load         |= info.doesPtrLoad;
         does_ptr_store       |= info.doesPtrStore;
@@ -948,6 +1262,20 @@ static void calculateAndInitConstants(Transform &t) {
   bits_for_offset = min(bits_for_offset, config::max_offset_bits);
   bits_for_offset = min(bits_for_offset, bits_program_pointer);
 
+  // Narrow the offsets, but keep enough bits for the constant offsets and
+  // the accesses
+  bool narrowed = false;
+  if (offset_bits_limit) {
+    auto min_bits
+      = ilog2_ceil(add_saturate(max(const_gep_src, const_gep_tgt),
+                                max_access_size), true) + 1;
+    auto limit = max(round_up(min_bits, 4), (uint64_t)offset_bits_limit);
+    if (limit < bits_for_offset) {
+      bits_for_offset = limit;
+      narrowed = true;
+    }
+  }
+
   // ASSUMPTION: programs can only allocate up to half of address space
   // so the first bit of size is always zero.
   // We need this assumption to support negative offsets.
@@ -1005,13 +1333,323 @@ static void calculateAndInitConstants(Transform &t) {
                   << "\ndoes_ptr_mem_access: " << does_ptr_mem_access
                   << "\ndoes_int_mem_access: " << does_int_mem_access
                   << '\n';
+  return narrowed;
 }
 
 
 namespace tools {
 
+// Values that may be undef, and thus take a different value at each use
+static bool may_be_undef(const Value &v) {
+  if (dynamic_cast<const UndefValue*>(&v))
+    return true;
+  if (auto *in = dynamic_cast<const Input*>(&v))
+    return !config::disable_undef_input &&
+           !in->getAttributes().undefImpliesUB();
+  if (auto *agg = dynamic_cast<const AggregateValue*>(&v)) {
+    auto &vals = agg->getVals();
+    return any_of(vals.begin(), vals.end(),
+                  [](auto *val) { return may_be_undef(*val); });
+  }
+  return false;
+}
+
+// UB-free instructions that don't touch pointers
+static bool is_sliceable(const Instr &i) {
+  if (hasPtr(i.getType()))
+    return false;
+  for (auto *op : i.operands()) {
+    if (hasPtr(op->getType()))
+      return false;
+  }
+
+  if (auto *bop = dynamic_cast<const BinOp*>(&i)) {
+    switch (bop->getOp()) {
+    case BinOp::SDiv:
+    case BinOp::UDiv:
+    case BinOp::SRem:
+    case BinOp::URem:
+      return false;
+    default:
+      return true;
+    }
+  }
+  return dynamic_cast<const UnaryOp*>(&i) ||
+         dynamic_cast<const UnaryReductionOp*>(&i) ||
+         dynamic_cast<const TernaryOp*>(&i) ||
+         dynamic_cast<const ConversionOp*>(&i) ||
+         dynamic_cast<const ICmp*>(&i) ||
+         dynamic_cast<const Select*>(&i) ||
+         dynamic_cast<const Freeze*>(&i);
+}
+
+// Instructions that compute the same value in src and tgt: same name, text
+// and basic block, and operands that are either the same instructions or not
+// instructions. Their values can be replaced with variables shared by src and
+// tgt, which is an over-approximation since they have no UB.
+// Values that depend on undef are excluded (unless frozen), since each of
+// their uses may observe a different value, unlike a shared variable.
+static pair<unordered_set<const Value*>, unordered_set<const Value*>>
+slice_identical(const Transform &t) {
+  auto print = [](const Instr &i) {
+    ostringstream os;
+    i.print(os);
+    return std::move(os).str();
+  };
+
+  unordered_map<string, pair<const Instr*, const BasicBlock*>> tgt_instrs;
+  for (auto bb : t.tgt.getBBs()) {
+    for (auto &i : bb->instrs()) {
+      tgt_instrs.emplace(i.getName(), make_pair(&i, bb));
+    }
+  }
+
+  vector<pair<const Instr*, const Instr*>> candidates;
+  for (auto bb : t.src.getBBs()) {
+    for (auto &i : bb->instrs()) {
+      auto I = tgt_instrs.find(i.getName());
+      if (I != tgt_instrs.end() && is_sliceable(i) &&
+          I->second.second->getName() == bb->getName() &&
+          print(i) == print(*I->second.first))
+        candidates.emplace_back(&i, I->second.first);
+    }
+  }
+
+  unordered_set<string> same;
+  bool changed;
+  do {
+    changed = false;
+    for (auto &[src, tgt] : candidates) {
+      if (same.count(src->getName()))
+        continue;
+      auto ops = src->operands();
+      bool freeze = dynamic_cast<const Freeze*>(src);
+      if (all_of(ops.begin(), ops.end(), [&](auto *op) {
+            if (dynamic_cast<const Instr*>(op))
+              return same.count(op->getName()) != 0;
+            return freeze || !may_be_undef(*op);
+          })) {
+        same.emplace(src->getName());
+        changed = true;
+      }
+    }
+  } while (changed);
+
+  pair<unordered_set<const Value*>, unordered_set<const Value*>> ret;
+  for (auto &[src, tgt] : candidates) {
+    if (same.count(src->getName())) {
+      ret.first.emplace(src);
+      ret.second.emplace(tgt);
+    }
+  }
+  return ret;
+}
+
+namespace {
+// A loop whose header is the only entry and the only exit, with a single
+// back-edge, and that only computes scalar values.
+struct SimpleLoop {
+  const BasicBlock *header = nullptr, *preheader = nullptr, *latch = nullptr;
+  // phi -> (value from the preheader, value from the latch)
+  map<string, tuple<const Phi*, const Value*, const Value*>> phis;
+};
+}
+
+// Whether v may depend on undef. Each use of such a value may observe a
+// different value. Conservative for instructions other than phis and the
+// sliceable ones.
+static bool depends_on_undef(const Value &v,
+                             unordered_set<const Value*> &seen) {
+  if (!seen.emplace(&v).second || dynamic_cast<const Freeze*>(&v))
+    return false;
+
+  auto *i = dynamic_cast<const Instr*>(&v);
+  if (!i)
+    return may_be_undef(v);
+
+  if (!dynamic_cast<const Phi*>(i) && !dynamic_cast<const BinOp*>(i) &&
+      !is_sliceable(*i))
+    return true;
+  for (auto *op : i->operands()) {
+    if (depends_on_undef(*op, seen))
+      return true;
+  }
+  return false;
+}
+
+static optional<SimpleLoop> find_simple_loop(Function &f) {
+  LoopAnalysis la(f);
+  auto &roots = la.getRoots();
+  if (roots.size() != 1)
+    return {};
+
+  SimpleLoop loop;
+  loop.header = roots[0];
+  unordered_set<const BasicBlock*> bbs = { loop.header };
+  for (auto *bb : la.getLoopForest().at(roots[0])) {
+    // nested loop
+    if (la.getLoopForest().count(bb))
+      return {};
+    bbs.emplace(bb);
+  }
+
+  for (auto *bb : f.getBBs()) {
+    for (auto &dst : bb->targets()) {
+      bool src_in = bbs.count(bb), dst_in = bbs.count(&dst);
+      if (src_in && !dst_in && bb != loop.header)
+        return {};
+      if (!src_in && dst_in && &dst != loop.header)
+        return {};
+      if (&dst != loop.header)
+        continue;
+      auto &pred = src_in ? loop.latch : loop.preheader;
+      if (pred)
+        return {};
+      pred = bb;
+    }
+  }
+  if (!loop.preheader || !loop.latch)
+    return {};
+
+  for (auto *bb : bbs) {
+    for (auto &i : bb->instrs()) {
+      if (auto *phi = dynamic_cast<const Phi*>(&i)) {
+        if (bb != loop.header || phi->getValues().size() != 2)
+          return {};
+        auto &ty = phi->getType();
+        if (!ty.isIntType() && !ty.isFloatType())
+          return {};
+        const Value *pre = nullptr, *back = nullptr;
+        for (auto &[val, pred] : phi->getValues()) {
+          (pred == loop.preheader->getName() ? pre : back) = val;
+        }
+        if (!pre || !back)
+          return {};
+        loop.phis.emplace(phi->getName(), make_tuple(phi, pre, back));
+        continue;
+      }
+
+      if (dynamic_cast<const Branch*>(&i))
+        continue;
+
+      if (auto *bop = dynamic_cast<const BinOp*>(&i)) {
+        if (hasPtr(bop->getType()))
+          return {};
+        continue;
+      }
+      if (!is_sliceable(i))
+        return {};
+    }
+  }
+
+  // the phis are replaced with a single variable in all their uses
+  unordered_set<const Value*> seen;
+  for (auto &[name, phi] : loop.phis) {
+    if (depends_on_undef(*get<0>(phi), seen))
+      return {};
+  }
+  return loop;
+}
+
+static expr eq_modulo_poison(const StateValue &a, const StateValue &b) {
+  return a.non_poison == b.non_poison &&
+         a.non_poison.implies(a.value == b.value);
+}
+
+// Proves the loops correct for any number of iterations, using as invariant
+// that the header phis with the same name in src and tgt are equal:
+//  - base: src and tgt enter the loop together, with equal phis;
+//  - step: if src doesn't have UB in an iteration, neither does tgt, both
+//    leave the loop together, and otherwise the phis are equal again;
+//  - exit: refinement holds with the phis replaced by shared variables.
+// Loops that don't match by header and phi names are not supported.
+bool TransformVerify::proveLoopsByInduction() const {
+  auto src_loop = find_simple_loop(t.src);
+  auto tgt_loop = find_simple_loop(t.tgt);
+  if (!src_loop || !tgt_loop ||
+      src_loop->header->getName() != tgt_loop->header->getName() ||
+      src_loop->phis.size() != tgt_loop->phis.size())
+    return false;
+
+  Slice slice;
+  for (auto &[name, src_phi] : src_loop->phis) {
+    auto I = tgt_loop->phis.find(name);
+    if (I == tgt_loop->phis.end() ||
+        get<0>(src_phi)->getType().toString() !=
+          get<0>(I->second)->getType().toString())
+      return false;
+    slice.first.emplace(get<0>(src_phi));
+    slice.second.emplace(get<0>(I->second));
+  }
+
+  try {
+    bool narrowed;
+    auto [src_state, tgt_state] = exec(0, narrowed, &slice);
+    auto &sink = t.src.getSinkBB();
+
+    auto pre = src_state->getAxioms()() && tgt_state->getAxioms()() &&
+               src_state->getPre()() && tgt_state->getPre()();
+
+    auto entry_src = src_state->jumpDomain(*src_loop->preheader,
+                                           *src_loop->header);
+    auto entry_tgt = tgt_state->jumpDomain(*tgt_loop->preheader,
+                                           *tgt_loop->header);
+    auto back_src = src_state->jumpDomain(*src_loop->latch, sink);
+    auto back_tgt = tgt_state->jumpDomain(*tgt_loop->latch, sink);
+
+    expr exit_src = false, exit_tgt = false;
+    for (auto &dst : src_loop->header->targets()) {
+      if (&dst != src_loop->header)
+        exit_src |= src_state->jumpDomain(*src_loop->header, dst);
+    }
+    for (auto &dst : tgt_loop->header->targets()) {
+      if (&dst != tgt_loop->header)
+        exit_tgt |= tgt_state->jumpDomain(*tgt_loop->header, dst);
+    }
+
+    expr base = true, step = true;
+    for (auto &[name, src_phi] : src_loop->phis) {
+      auto &tgt_phi = tgt_loop->phis.at(name);
+      base &= eq_modulo_poison(src_state->at(*get<1>(src_phi)).first,
+                               tgt_state->at(*get<1>(tgt_phi)).first);
+      if (!back_src.isFalse() && !back_tgt.isFalse())
+        step &= eq_modulo_poison(src_state->at(*get<2>(src_phi)).first,
+                                 tgt_state->at(*get<2>(tgt_phi)).first);
+    }
+
+    // src picks its undef values, as in the refinement check
+    auto qvars = src_state->getQuantVars();
+    for (auto &[var, val] : src_state->getValues()) {
+      qvars.insert(val.second.begin(), val.second.end());
+    }
+    auto &fn_qvars = tgt_state->getFnQuantVars();
+    qvars.insert(fn_qvars.begin(), fn_qvars.end());
+
+    // both must enter the loop together, as the phis are otherwise
+    // unconstrained in the one that enters it
+    expr base_fail = entry_src != entry_tgt ||
+                     (entry_src && entry_tgt && !base);
+    expr step_fail = (back_src && !(back_tgt && step)) ||
+                     (exit_src && !exit_tgt);
+    for (auto *fail : { &base_fail, &step_fail }) {
+      if (!check_expr(pre && expr::mkForAll(qvars, move(*fail))).isUnsat())
+        return false;
+    }
+  } catch (AliveException) {
+    return false;
+  }
+
+  bool narrowed;
+  return !check(0, narrowed, &slice);
+}
+
 TransformVerify::TransformVerify(Transform &t, bool check_each_var) :
   t(t), check_each_var(check_each_var) {
+  initTgtInstrs();
+}
+
+void TransformVerify::initTgtInstrs() const {
+  tgt_instrs.clear();
   if (check_each_var) {
     for (auto &i : t.tgt.instrs()) {
       tgt_instrs.emplace(i.getName(), &i);
@@ -1020,17 +1658,31 @@ TransformVerify::TransformVerify(Transform &t, bool check_each_var) :
 }
 
 pair<unique_ptr<State>, unique_ptr<State>> TransformVerify::exec() const {
+  bool narrowed;
+  return exec(0, narrowed);
+}
+
+pair<unique_ptr<State>, unique_ptr<State>>
+TransformVerify::exec(unsigned offset_bits_limit, bool &narrowed,
+                      const Slice *slice, unsigned unroll_limit) const {
+  TraceSpan span("vcgen", t.src.getName());
   ScopedWatch symexec_watch([](auto &w) {
     if (w.seconds() > 5)
       dbg() << "WARNING: slow vcgen! Took " << w << '\n';
   });
 
   t.tgt.syncDataWithSrc(t.src);
-  calculateAndInitConstants(t);
+  narrowed = calculateAndInitConstants(t, offset_bits_limit);
   State::resetGlobals();
 
   auto src_state = make_unique<State>(t.src, true);
   auto tgt_state = make_unique<State>(t.tgt, false);
+  if (slice) {
+    src_state->setAbstractValues(slice->first);
+    tgt_state->setAbstractValues(slice->second);
+  }
+  src_state->setUnrollLimit(unroll_limit);
+  tgt_state->setUnrollLimit(unroll_limit);
   sym_exec(*src_state);
   tgt_state->syncSEdataWithSrc(*src_state);
   sym_exec(*tgt_state);
@@ -1040,6 +1692,7 @@ pair<unique_ptr<State>, unique_ptr<State>> TransformVerify::exec() const {
 }
 
 Errors TransformVerify::verify() const {
+  TraceSpan span("verify", t.src.getName());
   if (!t.src.hasSameInputs(t.tgt)) {
     return { "Unsupported interprocedural transformation: signature mismatch "
              "between src and tgt", false };
@@ -1076,8 +1729,91 @@ Errors TransformVerify::verify() const {
   }
 
   Errors errs;
+  if (config::concrete_tests && falsify_concretely(t, check_each_var, errs))
+    return errs;
+
+  // Loops are only unrolled if the proof by induction fails
+  if (config::loop_induction) {
+    if (proveLoopsByInduction())
+      return errs;
+    t.src.unroll(config::src_unroll_cnt);
+    t.tgt.unroll(config::tgt_unroll_cnt);
+    initTgtInstrs();
+  }
+
+  // Try first with the instructions that are the same in src and tgt
+  // abstracted away. That loses their relation with the rest of the program,
+  // so only a successful result is final.
+  if (config::slice) {
+    auto slice = slice_identical(t);
+    bool narrowed;
+    if (!slice.first.empty() && !(errs = check(0, narrowed, &slice)))
+      return errs;
+  }
+
+  // Paths that need more iterations than the limit are cut, i.e., don't count
+  // in src and are excluded in tgt. Hence, a counterexample is final, but a
+  // proof is only if no path was cut.
+  if (config::unroll_deepen) {
+    unsigned max_unroll = max(config::src_unroll_cnt, config::tgt_unroll_cnt);
+    for (unsigned limit = 1; limit < max_unroll; limit *= 2) {
+      bool narrowed, truncated = true;
+      errs = check(0, narrowed, nullptr, limit, &truncated);
+      if (!truncated || errs.isUnsound())
+        return errs;
+    }
+  }
+
+  if (!config::adaptive_widths) {
+    bool narrowed;
+    return check(0, narrowed);
+  }
+
+  // Look for counterexamples with narrow offsets first. A result at a narrow
+  // width may be wrong either way (e.g., offsets that wrap around), so a
+  // counterexample is only reported if it reproduces at the full width with
+  // the same integer inputs, which is a much easier query. A correct result
+  // is only final at the full width.
+  bool narrowed;
+  InputModel cex;
+  errs = check(16, narrowed, nullptr, 0, nullptr, &cex);
+  if (!narrowed)
+    return errs;
+  if (errs.isUnsound()) {
+    errs = check(0, narrowed, nullptr, 0, nullptr, nullptr, &cex);
+    // without inputs to fix, this was already the full check
+    if (errs.isUnsound() || cex.empty())
+      return errs;
+  }
+  return check(0, narrowed);
+}
+
+Errors TransformVerify::check(unsigned offset_bits_limit, bool &narrowed,
+                              const Slice *slice, unsigned unroll_limit,
+                              bool *truncated, InputModel *cex_inputs,
+                              const InputModel *fixed_inputs) const {
+  Errors errs;
+  narrowed = false;
   try {
-    auto [src_state, tgt_state] = exec();
+    auto [src_state, tgt_state]
+      = exec(offset_bits_limit, narrowed, slice, unroll_limit);
+    if (fixed_inputs) {
+      for (auto &[var, val] : *fixed_inputs) {
+        tgt_state->addPre(var == val);
+      }
+    }
+    if (truncated) {
+      expr sink = src_state->sinkDomain() || tgt_state->sinkDomain();
+      *truncated = !sink.isFalse() &&
+                   !check_expr(src_state->getAxioms()() &&
+                               tgt_state->getAxioms()() &&
+                               src_state->getPre()() && tgt_state->getPre()() &&
+                               sink).isUnsat();
+    }
+
+    vector<pair<expr, expr>> lockstep_repls;
+    if (config::lockstep)
+      lockstep_repls = align_undef_vars(*src_state, *tgt_state);
 
     if (check_each_var) {
       for (auto &[var, val] : src_state->getValues()) {
@@ -1089,7 +1825,7 @@ Errors TransformVerify::verify() const {
         check_refinement(errs, t, *src_state, *tgt_state, var, var->getType(),
                          true, true, val,
                          true, true, tgt_state->at(*tgt_instrs.at(name)),
-                         check_each_var);
+                         check_each_var, lockstep_repls, cex_inputs);
         if (errs)
           return errs;
       }
@@ -1100,7 +1836,7 @@ Errors TransformVerify::verify() const {
                      src_state->returnVal(),
                      tgt_state->returnDomain()(), tgt_state->functionDomain()(),
                      tgt_state->returnVal(),
-                     check_each_var);
+                     check_each_var, lockstep_repls, cex_inputs);
   } catch (AliveException e) {
     return move(e);
   }
@@ -1311,6 +2047,7 @@ static void optimize_ptrcmp(Function &f) {
 }
 
 void Transform::preprocess() {
+  TraceSpan span("preprocess", src.getName());
   remove_unreachable_bbs(src);
   remove_unreachable_bbs(tgt);
 
@@ -1370,8 +2107,10 @@ void Transform::preprocess() {
   // bits_program_pointer is used by unroll. Initialize it in advance
   initBitsProgramPointer(*this);
 
-  src.unroll(config::src_unroll_cnt);
-  tgt.unroll(config::tgt_unroll_cnt);
+  if (!config::loop_induction) {
+    src.unroll(config::src_unroll_cnt);
+    tgt.unroll(config::tgt_unroll_cnt);
+  }
 }
 
 void Transform::print(ostream &os, const TransformPrintOpts &opt) const {
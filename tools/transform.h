@@ -11,6 +11,7 @@
 #include <string>
 #include <ostream>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace tools {
 
@@ -49,9 +50,33 @@ public:
 
 class TransformVerify {
   Transform &t;
-  std::unordered_map<std::string, const IR::Instr*> tgt_instrs;
+  // rebuilt if the loops are unrolled after construction
+  mutable std::unordered_map<std::string, const IR::Instr*> tgt_instrs;
   bool check_each_var;
 
+  void initTgtInstrs() const;
+
+  // instructions of src and tgt to encode as unconstrained values
+  using Slice = std::pair<std::unordered_set<const IR::Value*>,
+                          std::unordered_set<const IR::Value*>>;
+
+  // values of inputs in a counterexample
+  using InputModel = std::vector<std::pair<smt::expr, smt::expr>>;
+
+  // a non-zero offset_bits_limit narrows the pointer offsets to that width
+  // a non-zero unroll_limit cuts loops after that many iterations; truncated
+  // is set if some path was cut
+  // cex_inputs is set to the integer inputs of a counterexample, if any;
+  // fixed_inputs restricts the inputs to the given values
+  std::pair<std::unique_ptr<IR::State>,std::unique_ptr<IR::State>>
+    exec(unsigned offset_bits_limit, bool &narrowed,
+         const Slice *slice = nullptr, unsigned unroll_limit = 0) const;
+  util::Errors check(unsigned offset_bits_limit, bool &narrowed,
+                     const Slice *slice = nullptr, unsigned unroll_limit = 0,
+                     bool *truncated = nullptr, InputModel *cex_inputs = nullptr,
+                     const InputModel *fixed_inputs = nullptr) const;
+  bool proveLoopsByInduction() const;
+
 public:
   TransformVerify(Transform &t, bool check_each_var);
   std::pair<std::unique_ptr<IR::State>,std::unique_ptr<IR::State>> exec() const;
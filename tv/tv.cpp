@@ -7,8 +7,12 @@
 #include "smt/smt.h"
 #include "smt/solver.h"
 #include "tools/transform.h"
+#include "util/compiler.h"
+#include "util/config.h"
+#include "util/file.h"
 #include "util/parallel.h"
 #include "util/stopwatch.h"
+#include "util/thread_pool.h"
 #include "util/version.h"
 #include "llvm/ADT/Any.h"
 #include "llvm/ADT/Triple.h"
@@ -19,12 +23,15 @@
 #include "llvm/Passes/PassBuilder.h"
 #include "llvm/Passes/PassPlugin.h"
 #include "llvm/Support/raw_ostream.h"
+#include <atomic>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <memory>
 #include <random>
 #include <signal.h>
 #include <sstream>
+#include <thread>
 #include <unistd.h>
 #include <unordered_map>
 #include <utility>
@@ -46,7 +53,8 @@ llvm::cl::opt<string> parallel_tv("tv-parallel",
   llvm::cl::desc("Parallelization mode. Accepted values:"
                   " unrestricted (no throttling)"
                   ", fifo (use Alive2's job server)"
-                  ", null (developer mode)"),
+                  ", null (developer mode)"
+                  ", threads (in-process worker threads)"),
   llvm::cl::cat(alive_cmdargs));
 
 llvm::cl::opt<int> max_subprocesses("max-subprocesses",
@@ -54,11 +62,97 @@ llvm::cl::opt<int> max_subprocesses("max-subprocesses",
                  "time (default=128)"),
   llvm::cl::init(128), llvm::cl::cat(alive_cmdargs));
 
+llvm::cl::opt<unsigned> max_threads("tv-max-threads",
+  llvm::cl::desc("Number of worker threads with -tv-parallel=threads "
+                 "(default=number of cores)"),
+  llvm::cl::init(0), llvm::cl::cat(alive_cmdargs));
+
 llvm::cl::opt<long> subprocess_timeout("tv-subprocess-timeout",
   llvm::cl::desc("Maximum time, in seconds, that a parallel TV call "
                  "will be allowed to execeute (default=infinite)"),
   llvm::cl::init(-1), llvm::cl::cat(alive_cmdargs));
 
+llvm::cl::opt<string> cache_dir("tv-cache",
+  llvm::cl::desc("Directory of a persistent cache of verification results "
+                 "(default=disabled)"),
+  llvm::cl::value_desc("directory"), llvm::cl::cat(alive_cmdargs));
+
+
+// Persistent store of verification results, keyed by the hash of the printed
+// functions, the data layout, the options that affect the result, and the
+// Alive2 version. Each entry holds the verdict and the full key (to rule out
+// hash collisions), followed by the output to replay.
+class VerdictCache {
+  string key;
+  fs::path path;
+
+public:
+  VerdictCache(const Function &fn, const string &src, const string &tgt) {
+    ostringstream opts;
+    opts << fn.bitsPointers() << ' ' << fn.bitsPtrOffset() << ' '
+         << fn.isLittleEndian() << ' '
+         << config::src_unroll_cnt << ' ' << config::tgt_unroll_cnt << ' '
+         << config::disable_undef_input << config::disable_poison_input << ' '
+         << opt_smt_to << ' ' << opt_smt_max_mem << ' ' << opt_smt_random_seed
+         << ' ' << config::max_offset_bits << ' ' << config::concrete_tests
+         << ' ' << opt_smt_skip << opt_quiet << opt_bidirectional
+         << config::adaptive_widths << config::unroll_deepen
+         << config::loop_induction << config::slice << config::lockstep
+         << config::points_to << ' ' << config::prune_paths_timeout << ' '
+         << config::split_memory << ' ' << config::memop_unroll_bytes;
+
+    key = alive_version;
+    key += '\n';
+    key += opts.str();
+    key += '\n';
+    key += src;
+    key += tgt;
+
+    uint64_t h = fnv1a(key);
+
+    ostringstream name;
+    name << hex << setw(16) << setfill('0') << h << ".tv";
+    path = fs::path(cache_dir.getValue()) / name.str();
+  }
+
+  // Returns the output of the cached run and whether the transformation was
+  // found unsound.
+  optional<pair<string, bool>> lookup() const {
+    ifstream file(path);
+    string verdict;
+    size_t len;
+    if (!(file >> verdict >> len) || len != key.size() ||
+        (verdict != "ok" && verdict != "unsound") || file.get() != '\n')
+      return {};
+
+    string stored(len, '\0');
+    if (!file.read(stored.data(), len) || stored != key)
+      return {};
+
+    stringstream output;
+    output << file.rdbuf();
+    return make_pair(output.str(), verdict == "unsound");
+  }
+
+  void store(bool unsound, const string &output) const {
+    // write to a temporary file first so concurrent readers never observe
+    // a partial entry
+    error_code ec;
+    fs::create_directories(cache_dir.getValue(), ec);
+    auto tmp = get_random_filename(cache_dir, "tmp");
+    {
+      ofstream file(tmp);
+      if (!file.is_open())
+        return;
+      file << (unsound ? "unsound" : "ok") << ' ' << key.size() << '\n'
+           << key << output;
+    }
+    fs::rename(tmp, path, ec);
+    if (ec)
+      fs::remove(tmp, ec);
+  }
+};
+
 
 struct FnInfo {
   Function fn;
@@ -72,11 +166,12 @@ TransformPrintOpts print_opts;
 unordered_map<string, FnInfo> fns;
 unsigned initialized = 0;
 bool showed_stats = false;
-bool has_failure = false;
+atomic<bool> has_failure = false;
 // If is_clangtv is true, tv should exit with zero
 bool is_clangtv = false;
 unique_ptr<parallel> parallelMgr;
 stringstream parent_ss;
+unique_ptr<thread_pool> threadPool;
 
 void sigalarm_handler(int) {
   parallelMgr->finishChild(/*is_timeout=*/true);
@@ -97,6 +192,12 @@ string toString(const Function &fn) {
   return ss.str();
 }
 
+void setMainOutput(ostream &os) {
+  out = &os;
+  set_outs(os);
+  config::set_debug(os);
+}
+
 static void showStats() {
   if (opt_smt_stats)
     smt::solver_print_stats(*out);
@@ -184,9 +285,13 @@ struct TVLegacyPass final : public llvm::ModulePass {
   static bool verify(Transform &t, int n, const string &src_tostr) {
     printDot(t.tgt, n);
 
+    string tgt_tostr;
+    if (!opt_always_verify || !cache_dir.empty())
+      tgt_tostr = toString(t.tgt);
+
     if (!opt_always_verify) {
       // Compare Alive2 IR and skip if syntactically equal
-      if (src_tostr == toString(t.tgt)) {
+      if (src_tostr == tgt_tostr) {
         if (!opt_quiet)
           t.print(*out, print_opts);
         *out << "Transformation seems to be correct! (syntactically equal)\n\n";
@@ -194,6 +299,33 @@ struct TVLegacyPass final : public llvm::ModulePass {
       }
     }
 
+    optional<VerdictCache> cache;
+    if (!cache_dir.empty()) {
+      cache.emplace(t.src, opt_always_verify ? toString(t.src) : src_tostr,
+                    tgt_tostr);
+      if (auto hit = cache->lookup()) {
+        *out << hit->first;
+        if (hit->second) {
+          has_failure = true;
+          if (opt_error_fatal)
+            finalize();
+        }
+        // tgt is regenerated to keep fn_tostr in sync
+        return true;
+      }
+    }
+
+    if (threadPool) {
+      // Transform isn't copyable and std::function requires a copyable
+      // callable, hence the shared_ptr
+      auto job = make_shared<Transform>(move(t));
+      setMainOutput(threadPool->enqueue([job, cache](ostream &os) {
+        verifyInThread(*job, os, cache ? &*cache : nullptr);
+      }));
+      // tgt was handed over to the worker; regenerate it
+      return true;
+    }
+
     if (parallelMgr) {
       out_file.flush();
       auto [pid, osp, index] = parallelMgr->limitedFork();
@@ -237,45 +369,80 @@ struct TVLegacyPass final : public llvm::ModulePass {
      * is non-null; instead we call parallelMgr->finishChild()
      */
 
-    smt_init->reset();
+    if (verifyTransform(t, *smt_init, *out, cache ? &*cache : nullptr) &&
+        opt_error_fatal && has_failure)
+      finalize();
+
+    if (parallelMgr) {
+      showStats();
+      signal(SIGALRM, SIG_IGN);
+      llvm_util_init.reset();
+      smt_init.reset();
+      parallelMgr->finishChild(/*is_timeout=*/false);
+      exit(0);
+    }
+
+    // Regenerate tgt because preprocessing may have changed it
+    return true;
+  }
+
+  // Returns true if the transformation doesn't verify.
+  static bool verifyTransform(Transform &t, smt::smt_initializer &smt_init,
+                              ostream &os, const VerdictCache *cache) {
+    // with a cache, the output is buffered so it can be stored
+    ostringstream buf;
+    ostream &res_os = cache ? buf : os;
+
+    smt_init.reset();
     t.preprocess();
     TransformVerify verifier(t, false);
     if (!opt_quiet)
-      t.print(*out, print_opts);
+      t.print(res_os, print_opts);
 
+    bool typed;
     {
       auto types = verifier.getTypings();
-      if (!types) {
-        *out << "Transformation doesn't verify!\n"
-                "ERROR: program doesn't type check!\n\n";
-        goto done;
-      }
-      assert(types.hasSingleTyping());
+      typed = types;
+      assert(!typed || types.hasSingleTyping());
     }
 
-    if (Errors errs = verifier.verify()) {
-      *out << "Transformation doesn't verify!\n" << errs << endl;
-      has_failure |= errs.isUnsound();
-      if (opt_error_fatal && has_failure)
-        finalize();
+    bool failed = false, unsound = false, cacheable = true;
+    if (!typed) {
+      res_os << "Transformation doesn't verify!\n"
+                "ERROR: program doesn't type check!\n\n";
+    } else if (Errors errs = verifier.verify()) {
+      res_os << "Transformation doesn't verify!\n" << errs << endl;
+      failed = true;
+      unsound = errs.isUnsound();
+      // timeouts and approximations may go away in a later run
+      cacheable = unsound;
     } else {
-      *out << "Transformation seems to be correct!\n\n";
+      res_os << "Transformation seems to be correct!\n\n";
     }
 
-    // Regenerate tgt because preprocessing may have changed it
-    if (!parallelMgr)
-      return true;
+    if (unsound)
+      has_failure = true;
 
-  done:
-    if (parallelMgr) {
-      showStats();
-      signal(SIGALRM, SIG_IGN);
-      llvm_util_init.reset();
-      smt_init.reset();
-      parallelMgr->finishChild(/*is_timeout=*/false);
-      exit(0);
+    if (cache) {
+      os << buf.str();
+      if (cacheable)
+        cache->store(unsound, buf.str());
     }
-    return false;
+    return failed;
+  }
+
+  // Runs on a worker thread of -tv-parallel=threads
+  static void verifyInThread(Transform &t, ostream &os,
+                             const VerdictCache *cache) {
+    // each worker thread has its own SMT context
+    static thread_local smt::smt_initializer smt_thread_init;
+
+    // with -tv-error-fatal, skip the remaining jobs; finalize() will abort
+    if (opt_error_fatal && has_failure)
+      return;
+
+    config::set_debug(os);
+    verifyTransform(t, smt_thread_init, os, cache);
   }
 
   bool doInitialization(llvm::Module &module) override {
@@ -297,6 +464,14 @@ struct TVLegacyPass final : public llvm::ModulePass {
       parallelMgr = make_unique<fifo>(max_subprocesses, parent_ss, *out);
     } else if (parallel_tv == "null") {
       parallelMgr = make_unique<null>(max_subprocesses, parent_ss, *out);
+    } else if (parallel_tv == "threads") {
+      unsigned n = max_threads ? max_threads
+                               : max(thread::hardware_concurrency(), 1u);
+      threadPool = make_unique<thread_pool>(n, *out);
+      setMainOutput(threadPool->output());
+      // forking while other threads run Z3 may deadlock the child
+      config::split_memory = min(config::split_memory, 1u);
+      smt::solver_portfolio(1);
     } else if (!parallel_tv.empty()) {
       *out << "Alive2: Unknown parallelization mode: " << parallel_tv << endl;
       exit(1);
@@ -325,6 +500,12 @@ struct TVLegacyPass final : public llvm::ModulePass {
   }
 
   static void finalize() {
+    if (threadPool) {
+      threadPool->finish();
+      threadPool.reset();
+      setMainOutput(out_file.is_open() ? out_file : cout);
+    }
+
     if (parallelMgr) {
       parallelMgr->finishParent();
       out = out_file.is_open() ? &out_file : &cout;
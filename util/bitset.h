@@ -0,0 +1,56 @@
+#pragma once
+
+// Copyright (c) 2018-present The Alive2 Authors.
+// Distributed under the MIT license that can be found in the LICENSE file.
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace util {
+
+// A set of small unsigned integers that grows on demand.
+class BitSet {
+  std::vector<uint64_t> words;
+
+  static unsigned word(unsigned i) { return i / 64; }
+  static uint64_t bit(unsigned i) { return uint64_t(1) << (i % 64); }
+
+public:
+  bool count(unsigned i) const {
+    return word(i) < words.size() && (words[word(i)] & bit(i));
+  }
+
+  // returns true if i wasn't in the set
+  bool insert(unsigned i) {
+    if (word(i) >= words.size())
+      words.resize(word(i) + 1);
+    bool ret = !(words[word(i)] & bit(i));
+    words[word(i)] |= bit(i);
+    return ret;
+  }
+
+  void erase(unsigned i) {
+    if (word(i) < words.size())
+      words[word(i)] &= ~bit(i);
+  }
+
+  BitSet& operator&=(const BitSet &other) {
+    words.resize(std::min(words.size(), other.words.size()));
+    for (size_t i = 0, e = words.size(); i != e; ++i) {
+      words[i] &= other.words[i];
+    }
+    return *this;
+  }
+
+  BitSet& operator|=(const BitSet &other) {
+    if (words.size() < other.words.size())
+      words.resize(other.words.size());
+    for (size_t i = 0, e = other.words.size(); i != e; ++i) {
+      words[i] |= other.words[i];
+    }
+    return *this;
+  }
+};
+
+}
@@ -63,4 +63,12 @@ uint64_t round_up(uint64_t n, uint64_t amount) {
   return divide_up(n, amount) * amount;
 }
 
+uint64_t fnv1a(string_view str, uint64_t h) {
+  for (unsigned char c : str) {
+    h ^= c;
+    h *= 0x100000001b3;
+  }
+  return h;
+}
+
 }
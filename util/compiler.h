@@ -5,6 +5,7 @@
 
 #include <cassert>
 #include <cstdint>
+#include <string_view>
 
 #ifdef _MSC_VER
 # define UNREACHABLE() __assume(0)
@@ -55,4 +56,7 @@ uint64_t mul_saturate(uint64_t a, uint64_t b);
 uint64_t divide_up(uint64_t n, uint64_t amount); // division with ceiling
 uint64_t round_up(uint64_t n, uint64_t amount);
 
+// 64-bit FNV-1a; pass a previous hash as h to hash several strings
+uint64_t fnv1a(std::string_view str, uint64_t h = 0xcbf29ce484222325);
+
 }
@@ -6,18 +6,30 @@
 
 using namespace std;
 
-static ostream *debug_os = &cerr;
+static thread_local ostream *debug_os = &cerr;
 
 namespace util::config {
 
 bool symexec_print_each_value = false;
 bool skip_smt = false;
 string smt_benchmark_dir;
+string smt_cache_dir;
+bool incremental_refinement = false;
+unsigned split_memory = 0;
+unsigned concrete_tests = 0;
+bool adaptive_widths = false;
+bool lockstep = false;
+bool slice = false;
 bool disable_poison_input = false;
 bool disable_undef_input = false;
 bool debug = false;
 unsigned src_unroll_cnt = 0;
 unsigned tgt_unroll_cnt = 0;
+bool unroll_deepen = false;
+bool loop_induction = false;
+unsigned prune_paths_timeout = 0;
+bool points_to = false;
+unsigned memop_unroll_bytes = 64;
 unsigned max_offset_bits = 64;
 
 ostream &dbg() {
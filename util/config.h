@@ -15,6 +15,32 @@ extern bool skip_smt;
 // don't dumo if empty
 extern std::string smt_benchmark_dir;
 
+// persistent cache of SMT query results; disabled if empty
+extern std::string smt_cache_dir;
+
+// run all refinement checks of a function in a single incremental solver
+extern bool incremental_refinement;
+
+// number of random/boundary inputs to execute concretely before SMT
+// (0 = disabled)
+extern unsigned concrete_tests;
+
+// look for counterexamples with narrow pointer offsets first; proofs always
+// use the full width
+extern bool adaptive_widths;
+
+// check the memory refinement of each block in a separate query, running up
+// to this many queries in parallel (0 = disabled)
+extern unsigned split_memory;
+
+// make src pick the same undef values as tgt in identical instructions
+// before trying the full refinement query
+extern bool lockstep;
+
+// abstract instructions that are the same in src and tgt before trying the
+// full refinement query
+extern bool slice;
+
 extern bool disable_poison_input;
 
 extern bool disable_undef_input;
@@ -25,11 +51,31 @@ extern unsigned src_unroll_cnt;
 
 extern unsigned tgt_unroll_cnt;
 
+// verify with 1, 2, 4, ... loop iterations first and only go up to the unroll
+// factors if some path needs more iterations
+extern bool unroll_deepen;
+
+// try to prove loops correct for any number of iterations by induction before
+// unrolling them
+extern bool loop_induction;
+
+// time budget (ms) to check if the path condition of each BB is satisfiable;
+// BBs that are unreachable are not executed (0 = disabled)
+extern unsigned prune_paths_timeout;
+
+// narrow the blocks that pointers may alias with a points-to analysis
+extern bool points_to;
+
+// memset/memcpy with a constant size up to this many bytes and constant
+// offsets are lowered to byte stores instead of lambdas
+extern unsigned memop_unroll_bytes;
+
 // The maximum number of bits to use for offset computations. Note that this may
 // impact correctness, if values involved in offset computations exceed the
 // maximum.
 extern unsigned max_offset_bits;
 
+// the debug stream is per thread
 std::ostream &dbg();
 void set_debug(std::ostream &os);
 
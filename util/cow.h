@@ -0,0 +1,39 @@
+#pragma once
+
+// Copyright (c) 2018-present The Alive2 Authors.
+// Distributed under the MIT license that can be found in the LICENSE file.
+
+#include <compare>
+#include <memory>
+#include <utility>
+
+namespace util {
+
+// A value shared by all copies until one of them modifies it through write().
+template <typename T>
+class cow {
+  std::shared_ptr<T> ptr;
+
+public:
+  cow() : ptr(std::make_shared<T>()) {}
+  cow(T &&v) : ptr(std::make_shared<T>(std::move(v))) {}
+
+  const T& operator*() const { return *ptr; }
+  const T* operator->() const { return ptr.get(); }
+
+  T& write() {
+    if (ptr.use_count() > 1)
+      ptr = std::make_shared<T>(*ptr);
+    return *ptr;
+  }
+
+  // true if neither copy was modified since they were split
+  bool shares(const cow &other) const { return ptr == other.ptr; }
+
+  auto operator<=>(const cow &rhs) const {
+    using R = decltype(*ptr <=> *rhs.ptr);
+    return shares(rhs) ? R::equivalent : *ptr <=> *rhs.ptr;
+  }
+};
+
+}
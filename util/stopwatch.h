@@ -19,6 +19,7 @@ public:
   StopWatch();
   void stop();
   float seconds() const;
+  auto getStart() const { return start; }
 
   friend std::ostream& operator<<(std::ostream &os, const StopWatch &w);
 };
@@ -5,6 +5,7 @@
 #include "ir/function.h"
 #include "ir/state.h"
 #include "util/config.h"
+#include "util/trace.h"
 #include <iostream>
 
 using namespace IR;
@@ -14,8 +15,12 @@ using util::config::dbg;
 namespace util {
 
 void sym_exec(State &s) {
+  TraceSpan span(s.isSource() ? "sym_exec src" : "sym_exec tgt");
   Function &f = const_cast<Function&>(s.getFn());
 
+  if (config::points_to)
+    s.setPointsTo(PointsTo(f));
+
   // global constants need to be created in the right order so they get the
   // first bids in source, and the last in target
   set<const Value*> seen_inits;
@@ -0,0 +1,82 @@
+// Copyright (c) 2018-present The Alive2 Authors.
+// Distributed under the MIT license that can be found in the LICENSE file.
+
+#include "util/thread_pool.h"
+#include <cassert>
+
+using namespace std;
+
+namespace util {
+
+thread_pool::thread_pool(unsigned num_threads, ostream &out) : out(out) {
+  chunks.emplace_back(make_unique<Chunk>());
+  for (unsigned i = 0; i < max(num_threads, 1u); ++i)
+    workers.emplace_back([this]() { worker(); });
+}
+
+thread_pool::~thread_pool() {
+  finish();
+}
+
+ostream& thread_pool::output() {
+  lock_guard lock(mutex);
+  return chunks.back()->output;
+}
+
+ostream& thread_pool::enqueue(Job &&job) {
+  lock_guard lock(mutex);
+  assert(!stop);
+  chunks.back()->done = true;
+  auto *chunk = chunks.emplace_back(make_unique<Chunk>()).get();
+  jobs.emplace_back(std::move(job), chunk);
+  chunks.emplace_back(make_unique<Chunk>());
+  emitOutput();
+  cv.notify_one();
+  return chunks.back()->output;
+}
+
+void thread_pool::worker() {
+  unique_lock lock(mutex);
+  while (true) {
+    cv.wait(lock, [&]() { return stop || !jobs.empty(); });
+    if (jobs.empty())
+      return;
+
+    auto [job, chunk] = std::move(jobs.front());
+    jobs.pop_front();
+
+    lock.unlock();
+    job(chunk->output);
+    lock.lock();
+
+    chunk->done = true;
+    emitOutput();
+  }
+}
+
+void thread_pool::emitOutput() {
+  while (!chunks.empty() && chunks.front()->done) {
+    out << chunks.front()->output.str();
+    chunks.pop_front();
+  }
+  out.flush();
+}
+
+void thread_pool::finish() {
+  {
+    lock_guard lock(mutex);
+    if (stop)
+      return;
+    stop = true;
+  }
+  cv.notify_all();
+  for (auto &t : workers)
+    t.join();
+  workers.clear();
+
+  lock_guard lock(mutex);
+  chunks.back()->done = true;
+  emitOutput();
+}
+
+}
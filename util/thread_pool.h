@@ -0,0 +1,58 @@
+#pragma once
+
+// Copyright (c) 2018-present The Alive2 Authors.
+// Distributed under the MIT license that can be found in the LICENSE file.
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+/*
+ * A fixed pool of worker threads fed from a FIFO work queue. Each job
+ * writes into its own buffer; buffers are emitted to the output stream
+ * in submission order, interleaved with whatever the submitting thread
+ * wrote in between, so the output matches a sequential run.
+ */
+class thread_pool {
+  struct Chunk {
+    std::stringstream output;
+    bool done = false;
+  };
+  using Job = std::function<void(std::ostream&)>;
+
+  std::ostream &out;
+  std::vector<std::thread> workers;
+  std::deque<std::pair<Job, Chunk*>> jobs;
+  // output not yet emitted; the last chunk belongs to the submitting thread
+  std::deque<std::unique_ptr<Chunk>> chunks;
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool stop = false;
+
+  void worker();
+  void emitOutput();
+
+public:
+  thread_pool(unsigned num_threads, std::ostream &out);
+  ~thread_pool();
+
+  // stream where the submitting thread should write its output
+  std::ostream& output();
+
+  // Queues a job and returns the new output stream of the submitting thread.
+  std::ostream& enqueue(Job &&job);
+
+  // Returns when all jobs have finished and their output was emitted.
+  void finish();
+};
+
+}
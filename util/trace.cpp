@@ -0,0 +1,115 @@
+// Copyright (c) 2018-present The Alive2 Authors.
+// Distributed under the MIT license that can be found in the LICENSE file.
+
+#include "util/trace.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+using namespace std;
+using namespace std::chrono;
+
+static atomic<int> trace_fd = -1;
+static pid_t trace_owner;
+static atomic<unsigned> num_threads = 0;
+
+static void write_event(const string &str) {
+  // a single write to a file opened with O_APPEND is not interleaved with
+  // writes from other threads or processes
+  auto ret = write(trace_fd, str.data(), str.size());
+  (void)ret;
+}
+
+static void print_json_string(ostream &os, string_view str) {
+  os << '"';
+  for (unsigned char c : str) {
+    if (c == '"' || c == '\\') {
+      os << '\\' << c;
+    } else if (c < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      os << buf;
+    } else {
+      os << c;
+    }
+  }
+  os << '"';
+}
+
+namespace util::trace {
+
+void start(const string &filename) {
+  if (enabled())
+    return;
+
+  int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND,
+                0644);
+  if (fd < 0) {
+    cerr << "Alive2: Couldn't open trace file " << filename << endl;
+    return;
+  }
+  trace_fd = fd;
+  trace_owner = getpid();
+
+  static bool registered = false;
+  if (!registered) {
+    atexit(finish);
+    registered = true;
+  }
+
+  // every event after this one is prefixed with a comma
+  ostringstream os;
+  os << "[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << trace_owner
+     << ",\"args\":{\"name\":\"alive2\"}}";
+  write_event(os.str());
+}
+
+void finish() {
+  if (!enabled())
+    return;
+  if (getpid() == trace_owner)
+    write_event("\n]\n");
+  close(trace_fd);
+  trace_fd = -1;
+}
+
+bool enabled() {
+  return trace_fd >= 0;
+}
+
+}
+
+namespace util {
+
+TraceSpan::TraceSpan(const char *name, string_view detail) {
+  if (!trace::enabled())
+    return;
+
+  watch.emplace([name, detail = string(detail)](const StopWatch &sw) {
+    if (!trace::enabled())
+      return;
+
+    static thread_local unsigned tid = num_threads++;
+    auto ts = duration_cast<microseconds>(sw.getStart().time_since_epoch());
+
+    ostringstream os;
+    os << ",\n{\"name\":";
+    print_json_string(os, name);
+    os << ",\"cat\":\"alive2\",\"ph\":\"X\",\"ts\":" << ts.count()
+       << ",\"dur\":" << (long long)(sw.seconds() * 1e6)
+       << ",\"pid\":" << getpid() << ",\"tid\":" << tid;
+    if (!detail.empty()) {
+      os << ",\"args\":{\"detail\":";
+      print_json_string(os, detail);
+      os << '}';
+    }
+    os << '}';
+    write_event(os.str());
+  });
+}
+
+}
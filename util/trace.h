@@ -0,0 +1,35 @@
+#pragma once
+
+// Copyright (c) 2018-present The Alive2 Authors.
+// Distributed under the MIT license that can be found in the LICENSE file.
+
+#include "util/stopwatch.h"
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace util {
+
+/*
+ * Tracing of the verification phases in the Chrome trace event format
+ * (load the file in chrome://tracing or ui.perfetto.dev).
+ * Events are appended to the file as they complete, so forked children
+ * write to the file of the process that started the trace.
+ */
+namespace trace {
+// The trace is finished at exit if not done before.
+void start(const std::string &filename);
+// Only the process that started the trace closes the JSON array.
+void finish();
+bool enabled();
+}
+
+// A span covering the lifetime of the object; a no-op if tracing is off.
+class TraceSpan {
+  std::optional<ScopedWatch> watch;
+
+public:
+  TraceSpan(const char *name, std::string_view detail = {});
+};
+
+}